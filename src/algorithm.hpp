@@ -1,17 +1,27 @@
 #pragma once 
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
 #include <functional>
 #include <memory>
 #include <queue>
+#include <string>
 
 #include "fimi.hpp"
+#include "ordering.hpp"
+#include "reduce.hpp"
 #include "platform.hpp"
+#include "profile.hpp"
+#include "progress.hpp"
 #include "queues.hpp"
 #include "sets.hpp"
+#include "serialize.hpp"
 
 using namespace std;
-//TODO: add min_support filtering for InClose algorithms!
 /**
 	Algorithm is parametrized by:
 		- 2 Set implementations (Extent/Intent)
@@ -20,21 +30,25 @@ using namespace std;
 	Set objects typically amount to >97% of all allocations.
 */
 #if defined(USE_LINEAR_EXT)
-	using ExtSet = LinearSet;
+	using ExtSet = LinearSet<0>;
 #elif defined(USE_BIT_EXT)
 	using ExtSet = BitVec<0>;
 #elif defined(USE_TREE_EXT)
-	using ExtSet = TreeSet;
+	using ExtSet = TreeSet<0>;
+#elif defined(USE_HASH_EXT)
+	using ExtSet = HashSet<0>;
 #else
 	#error "Must use some implementation for Extent!"
 #endif
 
 #if defined(USE_LINEAR_INT)
-	using IntSet = LinearSet;
+	using IntSet = LinearSet<1>;
 #elif defined(USE_BIT_INT)
 	using IntSet = BitVec<1>;
 #elif defined(USE_TREE_INT)
-	using IntSet = TreeSet;
+	using IntSet = TreeSet<1>;
+#elif defined(USE_HASH_INT)
+	using IntSet = HashSet<1>;
 #else
 	#error "Must use some implementation for Intent!"
 #endif
@@ -47,9 +61,244 @@ using namespace std;
 	#error "Must define one of legal USE_xxx_WRITER"
 #endif
 
-using CompIntSet = CompressedSet<IntSet>;
+// Intents with implied error (see FCbO paper) of one node of the search tree,
+// a layer of the stack that goes along with recursion.
+// Only non-null sets are kept, sorted by attribute. Stored sets are never modified,
+// they are shared between layers and with scheduled tasks by reference counting,
+// so memory doesn't grow with number of attributes times depth of recursion.
+class ImpliedSets{
+public:
+	struct Entry{
+		size_t j;
+		shared_ptr<IntSet> set;
+	};
+	using Iter = vector<Entry>::const_iterator;
+private:
+	vector<Entry> entries_;
+public:
+	// first set for attribute >= j
+	Iter from(size_t j)const{
+		return lower_bound(entries_.begin(), entries_.end(), j, [](const Entry& e, size_t j){
+			return e.j < j;
+		});
+	}
+	Iter end()const{ return entries_.end(); }
+
+	void clear(){ entries_.clear(); }
+
+	// take over set of the other layer if it has one for j, n walks the other layer in order of attributes
+	IntSet* inherit(const ImpliedSets& layer, Iter& n, size_t j){
+		if(n == layer.end() || n->j != j)
+			return nullptr;
+		entries_.push_back(*n);
+		return (n++)->set.get();
+	}
+
+	// set for j, attributes go in increasing order
+	void set(size_t j, IntSet&& set){
+		bool has = !entries_.empty() && entries_.back().j == j;
+		if(set.null()){
+			if(has)
+				entries_.pop_back();
+		}
+		else if(has)
+			entries_.back().set = make_shared<IntSet>(move(set));
+		else
+			entries_.push_back(Entry{j, make_shared<IntSet>(move(set))});
+	}
+
+	// share sets of the other layer for attributes >= j
+	void assign(const ImpliedSets& layer, size_t j){
+		entries_.assign(layer.from(j), layer.end());
+	}
+
+	// bytes of memory held, shared sets are counted in full
+	size_t footprint()const{
+		size_t bytes = entries_.capacity()*sizeof(Entry);
+		for(auto& e : entries_)
+			bytes += sizeof(IntSet) + e.set->footprint();
+		return bytes;
+	}
+
+	// sets for attributes >= j
+	void save(Encoder& enc, size_t j){
+		auto it = from(j);
+		enc.word(end() - it);
+		for(size_t prev = j; it != end(); prev = it->j, ++it){
+			enc.word(it->j - prev);
+			enc.set(*it->set, enc.attributes());
+		}
+	}
+	void load(Decoder& dec, size_t j, size_t attributes){
+		entries_.resize(dec.word());
+		for(auto& e : entries_){
+			e.j = j += dec.word();
+			e.set = make_shared<IntSet>();
+			dec.set(*e.set, attributes);
+		}
+	}
+};
+
+// Top-k collector - keeps the k best concepts seen so far, shared by forked algorithms.
+// Min-heap on score, so the worst of the current best is always on top and
+// the score it has gives minimal support a concept needs to get in.
+class TopK{
+public:
+	enum Rank{
+		SUPPORT, // support of concept
+		AREA // support x length of intent
+	};
+private:
+	struct Entry{
+		size_t score;
+		IntSet intent;
+		Entry(size_t s, IntSet i):score(s), intent(move(i)){}
+		bool operator<(const Entry& e)const{ return score > e.score; } // min-heap
+	};
+	vector<Entry> heap_;
+	size_t k_;
+	Rank rank_;
+	size_t attributes_;
+	atomic<size_t> min_score_; // least score that gets in once heap is full, 0 until then
+	mutex mtx_;
+
+	size_t threshold()const{
+		size_t score = min_score_.load(memory_order_relaxed);
+		if(!score)
+			return 0;
+		if(rank_ == SUPPORT)
+			return score;
+		// intent is at most all of attributes long, so support must be at least this
+		return (score + attributes_ - 1) / attributes_;
+	}
+public:
+	TopK(size_t k, Rank rank, size_t attributes):
+		k_(k), rank_(rank), attributes_(max((size_t)1, attributes)), min_score_(0){
+		heap_.reserve(k);
+	}
+
+	// Offer concept of given support to the top, returns minimal support for concepts to follow.
+	// Length of intent is given, counting attributes removed by context reduction.
+	size_t offer(size_t support, IntSet& B, size_t length){
+		size_t score = rank_ == SUPPORT ? support : support * length;
+		if(score < min_score_.load(memory_order_relaxed))
+			return threshold();
+		lock_guard<mutex> lock(mtx_);
+		if(heap_.size() < k_){
+			IntSet copy = IntSet::newEmpty();
+			copy.copy(B);
+			heap_.emplace_back(score, move(copy));
+			push_heap(heap_.begin(), heap_.end());
+		}
+		else if(score > heap_.front().score){
+			pop_heap(heap_.begin(), heap_.end());
+			heap_.back().score = score;
+			heap_.back().intent.copy(B);
+			push_heap(heap_.begin(), heap_.end());
+		}
+		if(heap_.size() == k_)
+			min_score_.store(heap_.front().score + 1, memory_order_relaxed);
+		return threshold();
+	}
+
+	// pass intents to fn from the best to the worst, empties the top
+	template<class Fn>
+	void drain(Fn&& fn){
+		lock_guard<mutex> lock(mtx_);
+		sort_heap(heap_.begin(), heap_.end());
+		for(auto& e : heap_)
+			fn(e.intent);
+		heap_.clear();
+	}
+};
+
+// Concepts counted instead of printed: histograms of intent lengths and of supports.
+// Supports go by powers of 2, bucket k > 0 has supports in [2^(k-1), 2^k), bucket 0 - support 0.
+class ConceptCounts{
+	vector<uint64_t> lengths_, supports_;
+
+	static void bump(vector<uint64_t>& hist, size_t i, uint64_t n=1){
+		if(hist.size() <= i)
+			hist.resize(i + 1);
+		hist[i] += n;
+	}
+public:
+	void add(size_t length, size_t support){
+		size_t bucket = 0;
+		for(; support; support >>= 1)
+			bucket++;
+		bump(lengths_, length);
+		bump(supports_, bucket);
+	}
+
+	ConceptCounts& operator+=(const ConceptCounts& c){
+		for(size_t i=0; i<c.lengths_.size(); i++)
+			bump(lengths_, i, c.lengths_[i]);
+		for(size_t i=0; i<c.supports_.size(); i++)
+			bump(supports_, i, c.supports_[i]);
+		return *this;
+	}
+
+	// histograms as they are, to be summed up over processes
+	vector<uint64_t>& lengths(){ return lengths_; }
+	vector<uint64_t>& supports(){ return supports_; }
+
+	uint64_t total()const{
+		uint64_t n = 0;
+		for(auto c : lengths_)
+			n += c;
+		return n;
+	}
+
+	// workers - worker thread number (-1 - not a worker thread) and concepts it found
+	void printJSON(ostream& os, const vector<pair<int, uint64_t>>& workers)const{
+		os << "{\n\t\"concepts\": " << total() << ",\n\t\"workers\": [";
+		for(size_t i=0; i<workers.size(); i++)
+			os << (i ? ", " : "") << "{\"worker\": " << workers[i].first << ", \"concepts\": " << workers[i].second << "}";
+		os << "],\n\t\"intent_lengths\": [";
+		for(size_t i=0; i<lengths_.size(); i++)
+			os << (i ? ", " : "") << lengths_[i];
+		os << "],\n\t\"supports\": [";
+		for(size_t k=0; k<supports_.size(); k++){
+			size_t from = k ? (size_t)1 << (k-1) : 0, to = k ? ((size_t)1 << k) - 1 : 0;
+			os << (k ? ",\n\t\t" : "\n\t\t") << "{\"from\": " << from << ", \"to\": " << to
+				<< ", \"concepts\": " << supports_[k] << "}";
+		}
+		os << "\n\t]\n}\n";
+	}
+};
+
+// Placement of worker threads on NUMA nodes with a replica of read-only context per node,
+// shared by forked algorithms. Replica is made by the first worker to need it on the node,
+// so its pages are first touched (and thus placed) there.
+struct NumaContext{
+	vector<vector<unsigned>> nodes; // CPUs of each node
+	vector<IntSet*> rows; // replica of rows for each node, null until needed
+	mutex mtx;
+	NumaContext():nodes(numaNodes()), rows(nodes.size()){}
+
+	// node of the calling thread, -1 if it is not pinned
+	static int& currentNode(){
+		static thread_local int node = -1;
+		return node;
+	}
+};
 
 class Algorithm {
+public:
+	// order of objects (rows) of the context
+	enum ObjectOrder{
+		INPUT, // as given
+		LEX, // lexicographic by attributes in the order they are processed, objects having one first
+		GRAY // reflected (Gray code) variant of LEX, fewer runs in later columns
+	};
+	// what is printed of each concept
+	enum OutputMode{
+		INTENTS, // attributes
+		SUPPORTS, // attributes and support: "1 2 3 (17)"
+		CONCEPTS, // attributes and objects: "1 2 3 | 0-4 7 9-12"
+		EXTENTS // objects: "0-4 7 9-12"
+	};
 private:
 	IntSet* rows; // attributes of objects
 	size_t attributes_;
@@ -58,44 +307,293 @@ private:
 	size_t min_support_; // minimal support for hypotheses
 	size_t* attributesNums; // sorted positions of attributes
 	size_t* revMapping; // attributes to sorted positions
+	size_t* objectsNums; // original numbers of reordered objects, grouped by merged object
+	size_t* objectsStarts; // where group of each object starts in objectsNums
+	ObjectOrder object_order_;
+	size_t original_attributes_; // attributes before reduction
+	bool reduce_, merge_objects_;
+	size_t* weights_; // original objects in each of merged ones, null if none were merged
+	// attribute removed by reduction, it is in every intent that has all of up
+	struct Expansion{
+		size_t attr;
+		IntSet up;
+	};
+	shared_ptr<vector<Expansion>> expansions_;
 	// ostream* out_;
 	ostream* diag_;
 	Buffer buf;
 	shared_ptr<mutex> output_mtx;
 	shared_ptr<IntWriter> writer;
+	OutputMode output_mode_;
+	bool binary_; // binary records instead of text lines, see printBinary
+	Encoder record_; // binary record being written
+	vector<size_t> items_; // scratch for original numbers of attributes or objects
 	//
-	bool sort_;
+	AttributeOrder::Kind attribute_order_;
 	size_t verbose_;
 	size_t par_level_;
 	size_t threads_;
 	
 	function<bool(IntSet&)> filter_;
+	shared_ptr<TopK> top_; // collect best concepts instead of printing all
+	bool top_owner_; // top is printed by the algorithm that set it up, not by forks
+	string checkpoint_file_; // where to keep checkpoints, empty if none
+	string checkpoint_output_; // path of the output file checkpoints are consistent with
+	double checkpoint_period_; // seconds between checkpoints
+	bool resume_; // continue from the checkpoint
+	size_t queue_budget_; // bytes of memory for queued tasks, 0 - unbounded
+	shared_ptr<NumaContext> numa_; // null unless in NUMA mode
+
+	// object a goes before b in (reflected) lexicographic order of their sorted attributes
+	static bool precedes(const vector<size_t>& a, const vector<size_t>& b, bool gray){
+		size_t i = 0;
+		while(i < a.size() && i < b.size() && a[i] == b[i])
+			i++;
+		if(i == a.size() && i == b.size())
+			return false;
+		// first difference: the one having the smaller attribute goes first,
+		// reflected after an odd number of common attributes
+		bool a_first = i == b.size() || (i < a.size() && a[i] < b[i]);
+		return gray && i % 2 ? !a_first : a_first;
+	}
+
+	// total number of runs of consecutive objects having an attribute, over all attributes
+	size_t columnRuns(const vector<vector<size_t>>& mapped){
+		vector<size_t> last(attributes_, ~(size_t)0); // last object having the attribute
+		size_t runs = 0;
+		for (size_t i = 0; i < objects_; i++){
+			for (auto pos : mapped[objectsNums[i]]){
+				if(last[pos] + 1 != i)
+					runs++;
+				last[pos] = i;
+			}
+		}
+		return runs;
+	}
 
+	// Counters of one algorithm (a worker thread for forked ones)
 	struct Stats{
-		int total;
-		int closures; // closures / partial closures computed
-		int fail_canon; // canonical test failures
-		int fail_fast; // fast canonical test failures
-		Stats(): total(0), closures(0), fail_canon(0), fail_fast(0){}
+		uint64_t total; // concepts
+		uint64_t closures; // closures / partial closures computed
+		uint64_t fail_canon; // canonical test failures
+		uint64_t fail_fast; // fast canonical test failures
+		uint64_t objects; // objects scanned by closures
+		uint64_t intersections; // rows intersected with intents
+		uint64_t scheduled; // tasks queued
+		uint64_t ran; // tasks taken from queue (or owned subtrees) and run
+		uint64_t stolen; // tasks received from other processes
+		uint64_t wait_ns; // waiting for tasks
+		uint64_t output_bytes;
+		uint64_t flush_ns; // writing output, including waits for the stream
+		PerfCounters::Values perf; // hardware counters of the worker thread, if enabled
+		Stats(): total(0), closures(0), fail_canon(0), fail_fast(0), objects(0), intersections(0),
+			scheduled(0), ran(0), stolen(0), wait_ns(0), output_bytes(0), flush_ns(0){}
+
+		Stats& operator+=(const Stats& s){
+			total += s.total;
+			closures += s.closures;
+			fail_canon += s.fail_canon;
+			fail_fast += s.fail_fast;
+			objects += s.objects;
+			intersections += s.intersections;
+			scheduled += s.scheduled;
+			ran += s.ran;
+			stolen += s.stolen;
+			wait_ns += s.wait_ns;
+			output_bytes += s.output_bytes;
+			flush_ns += s.flush_ns;
+			perf += s.perf;
+			return *this;
+		}
+
+		void printJSON(ostream& os)const{
+			os << "\"concepts\": " << total << ", \"closures\": " << closures
+				<< ", \"fail_canon\": " << fail_canon << ", \"fail_fast\": " << fail_fast
+				<< ", \"objects_scanned\": " << objects << ", \"intersections\": " << intersections
+				<< ", \"tasks_scheduled\": " << scheduled << ", \"tasks_run\": " << ran
+				<< ", \"tasks_stolen\": " << stolen << ", \"queue_wait_s\": " << wait_ns / 1e9
+				<< ", \"output_bytes\": " << output_bytes << ", \"flush_s\": " << flush_ns / 1e9;
+			if(PerfCounters::enabled()){
+				os << ", \"perf\": {";
+				perf.printJSON(os);
+				os << "}";
+			}
+		}
 	};
+private:
+	// Stats of an algorithm and all of its forks, reported by the former once they are done
+	struct StatsReport{
+		mutex mtx;
+		vector<pair<int, Stats>> workers; // worker thread number (-1 - not forked) and its counters
+		unique_ptr<Profile> profile; // sum of profiles, null unless profiling
+		ConceptCounts counts; // sum of counts of forks
+	};
+	shared_ptr<StatsReport> report_; // null if moved from
+	bool forked_;
+	string stats_file_; // JSON report goes there if not empty
+	unique_ptr<Profile> profile_; // null unless profiling
+	string profile_file_; // folded stacks of the profile go there if not empty
+	double progress_period_; // seconds between progress reports, 0 - none
+	shared_ptr<Progress> progress_; // null unless reporting progress
+	Progress::Slot* progress_slot_; // counters of this algorithm
+	unique_ptr<PerfCounters> perf_; // of the thread that forked this algorithm, null unless enabled
+	bool count_concepts_; // count concepts instead of printing them
+	ConceptCounts counts_;
+
+	// intent in original attributes, names a subtree in profile
+	string intentString(IntSet& B){
+		vector<size_t> attrs;
+		B.each([&](size_t i){
+			attrs.push_back(attributesNums[i]);
+		});
+		sort(attrs.begin(), attrs.end());
+		string s;
+		for(auto a : attrs){
+			if(!s.empty())
+				s += ' ';
+			s += to_string(a);
+		}
+		return s;
+	}
 protected:
 	
-	void printAttributes(IntSet& set){
-		if (verbose() >= 1){
-			bool nonempty = false;
-			bool need_ws = false;
-			set.each([&](size_t i){
-				size_t attr = attributesNums[i];
-				if(need_ws)
-					buf.put(' ');
-				else
-					need_ws = true;
-				if(attr < props_start)
-					nonempty = true;
-				writer->write(attr, buf);
+	// size of intent in original attributes
+	size_t intentLength(IntSet& set){
+		size_t length = set.count();
+		if(expansions_)
+			for(auto& e : *expansions_)
+				if(e.up.subsetOf(set, attributes_))
+					length++;
+		return length;
+	}
+
+	// apply fn to original attributes of intent, including ones removed by reduction
+	template<class Fn>
+	void eachAttribute(IntSet& set, Fn&& fn){
+		set.each([&](size_t i){
+			fn(attributesNums[i]);
+		});
+		if(expansions_)
+			for(auto& e : *expansions_)
+				if(e.up.subsetOf(set, attributes_))
+					fn(e.attr);
+	}
+
+	// sorted original numbers of objects of extent into items_
+	void originalObjects(ExtSet& A){
+		items_.clear();
+		A.each([&](size_t i){
+			eachOriginal(i, [&](size_t o){
+				items_.push_back(o);
 			});
-			buf.put('\n');
-			if(nonempty){
+		});
+		// reordered or merged objects, or a hash set that goes in no particular order
+		if(!is_sorted(items_.begin(), items_.end()))
+			sort(items_.begin(), items_.end());
+	}
+
+	void printNumber(size_t v){
+		char tmp[24];
+		char* p = tmp + sizeof(tmp);
+		do{
+			*--p = '0' + v % 10;
+			v /= 10;
+		}while(v);
+		buf.put(p, tmp + sizeof(tmp) - p);
+	}
+
+	// sorted numbers as ranges: 0-4 7 9-12, ws - space goes before the first one too
+	void printRanges(const vector<size_t>& items, bool ws){
+		for(size_t i=0; i<items.size(); ){
+			size_t k = i + 1;
+			while(k < items.size() && items[k] == items[k-1] + 1)
+				k++;
+			if(i || ws)
+				buf.put(' ');
+			printNumber(items[i]);
+			if(k - i > 1){
+				buf.put('-');
+				printNumber(items[k-1]);
+			}
+			i = k;
+		}
+	}
+
+	// text line of concept, false if intent has no attributes (but properties)
+	bool printText(ExtSet& A, IntSet& B){
+		bool nonempty = false;
+		bool need_ws = false;
+		eachAttribute(B, [&](size_t attr){
+			if(attr < props_start)
+				nonempty = true;
+			if(output_mode_ == EXTENTS)
+				return;
+			if(need_ws)
+				buf.put(' ');
+			else
+				need_ws = true;
+			writer->write(attr, buf);
+		});
+		if(output_mode_ == SUPPORTS){
+			buf.put(need_ws ? " (" : "(", need_ws ? 2 : 1);
+			printNumber(support(A));
+			buf.put(')');
+		}
+		else if(output_mode_ != INTENTS){
+			if(output_mode_ == CONCEPTS)
+				buf.put(need_ws ? " |" : "|", need_ws ? 2 : 1);
+			originalObjects(A);
+			printRanges(items_, output_mode_ == CONCEPTS);
+		}
+		buf.put('\n');
+		return nonempty;
+	}
+
+	// Binary record of concept, each part is a set in format of Encoder (see serialize.hpp):
+	// intent over original attributes unless EXTENTS, varint support if SUPPORTS,
+	// extent over original objects if CONCEPTS or EXTENTS.
+	// Sets are mostly delta varint lists or run lengths, whatever is shorter.
+	bool printBinary(ExtSet& A, IntSet& B){
+		bool nonempty = false;
+		items_.clear();
+		eachAttribute(B, [&](size_t attr){
+			if(attr < props_start)
+				nonempty = true;
+			items_.push_back(attr);
+		});
+		record_.clear();
+		if(output_mode_ != EXTENTS){
+			sort(items_.begin(), items_.end());
+			record_.items(items_, original_attributes_);
+		}
+		if(output_mode_ == SUPPORTS)
+			record_.word(support(A));
+		else if(output_mode_ != INTENTS){
+			originalObjects(A);
+			record_.items(items_, objectsStarts[objects_]);
+		}
+		auto& bytes = record_.bytes();
+		buf.put((const char*)bytes.data(), bytes.size());
+		return nonempty;
+	}
+
+	// header of binary output: "FCA", version 1, then varints of
+	// output mode, number of original attributes and of original objects
+	void printHeader(){
+		record_.clear();
+		for(auto c : {'F', 'C', 'A', '\1'})
+			record_.word((unsigned char)c);
+		record_.word(output_mode_);
+		record_.word(original_attributes_);
+		record_.word(objectsStarts[objects_]);
+		auto& bytes = record_.bytes();
+		buf.put((const char*)bytes.data(), bytes.size());
+		buf.commit();
+	}
+
+	void printConcept(ExtSet& A, IntSet& B){
+		if (verbose() >= 1){
+			if(binary_ ? printBinary(A, B) : printText(A, B)){
 				buf.commit();
 			}
 			else
@@ -104,71 +602,350 @@ protected:
 		stats.total++;
 	}
 
+	// objects having all of intent
+	void extentOf(IntSet& B, ExtSet& A){
+		for(size_t i=0; i<objects_; i++)
+			if(B.subsetOf(rows[i], attributes_))
+				A.add(i);
+	}
+
+	// sums stats of all workers up, prints totals and writes JSON report if asked to
 	void printStats(){
+		auto& workers = report_->workers;
+		sort(workers.begin(), workers.end(), [](const pair<int, Stats>& a, const pair<int, Stats>& b){
+			return a.first < b.first;
+		});
+		Stats sum;
+		for(auto& w : workers)
+			sum += w.second;
 		if (verbose() >= 2){
 			lock_guard<mutex> lock(*output_mtx);
 			*diag_ << "Total\tClosure\tCanonical\tFast\n"
-			     << stats.total << '\t'<< stats.closures 
-				 << '\t' << stats.fail_canon << '\t' << stats.fail_fast << endl;
+			     << sum.total << '\t'<< sum.closures 
+				 << '\t' << sum.fail_canon << '\t' << sum.fail_fast << endl;
+			if(PerfCounters::enabled()){
+				for(auto& w : workers){
+					if(w.first < 0)
+						continue;
+					*diag_ << "Worker " << w.first << " counters: ";
+					w.second.perf.print(*diag_);
+					*diag_ << endl;
+				}
+			}
+		}
+		if (!stats_file_.empty()){
+			ofstream out(stats_file_);
+			out << "{\n\t\"workers\": [\n";
+			for(size_t i=0; i<workers.size(); i++){
+				out << "\t\t{\"worker\": " << workers[i].first << ", ";
+				workers[i].second.printJSON(out);
+				out << "}" << (i+1 < workers.size() ? "," : "") << "\n";
+			}
+			out << "\t],\n\t\"total\": {";
+			sum.printJSON(out);
+			out << "}\n}\n";
+			if(!out)
+				*diag_ << "Failed to write stats to " << stats_file_ << endl;
+		}
+		if(report_->profile){
+			lock_guard<mutex> lock(*output_mtx);
+			report_->profile->printHistograms(*diag_, 10);
+			ofstream out(profile_file_);
+			report_->profile->printFolded(out);
+			if(!out)
+				*diag_ << "Failed to write profile to " << profile_file_ << endl;
+		}
+	}
+
+	// JSON of counts of this algorithm and all of its forks, they are done by now
+	void printCounts(){
+		ConceptCounts sum = counts_;
+		vector<pair<int, uint64_t>> workers{make_pair(-1, stats.total)};
+		{
+			lock_guard<mutex> lock(report_->mtx);
+			sum += report_->counts;
+			for(auto& w : report_->workers)
+				workers.emplace_back(w.first, w.second.total);
+		}
+		// one entry per worker, forks not on worker threads go with the root as -1
+		sort(workers.begin(), workers.end());
+		size_t n = 0;
+		for(size_t i=0; i<workers.size(); i++){
+			if(n && workers[n-1].first == workers[i].first)
+				workers[n-1].second += workers[i].second;
+			else
+				workers[n++] = workers[i];
 		}
+		workers.resize(n);
+		if(!reduceCounts(sum, workers))
+			return;
+		lock_guard<mutex> lock(*output_mtx);
+		sum.printJSON(buf.output(), workers);
+		buf.output().flush();
+	}
+
+	// sum counts up over processes, workers become processes; true if this process prints them
+	virtual bool reduceCounts(ConceptCounts&, vector<pair<int, uint64_t>>&){ return true; }
+
+	// worker number of the calling thread, -1 if it is not a worker
+	static int& currentWorker(){
+		static thread_local int worker = -1;
+		return worker;
 	}
 
 protected:
 	virtual void algorithm()=0;
 
+	// one call of algorithm (a concept) is profiled while in scope, B - intent on entry
+	class Frame{
+		Algorithm& algo_;
+	public:
+		Frame(Algorithm& algo, IntSet& B):algo_(algo){
+			if(algo_.profile_)
+				algo_.profile_->enter(algo_.stats.closures, [&]{ return algo_.intentString(B); });
+		}
+		~Frame(){
+			if(algo_.profile_)
+				algo_.profile_->leave(algo_.stats.closures);
+		}
+	};
+
 	// print intent and/or extent
 	virtual void output(ExtSet& A, IntSet& B){
+		if(progress_slot_)
+			Progress::Slot::bump(progress_slot_->concepts);
+		if(count_concepts_){
+			if(!filter_ || filter_(B)){
+				counts_.add(intentLength(B), support(A));
+				stats.total++;
+			}
+			return;
+		}
+		if(top_){
+			// empty intents are never printed, don't let them take a place in the top
+			size_t length = intentLength(B);
+			if(length && (!filter_ || filter_(B))) // raise support threshold as the top fills up
+				min_support_ = max(min_support_, top_->offer(support(A), B, length));
+			return;
+		}
 		if(verbose() >= 1){
 			if(!filter_ || filter_(B))
-				printAttributes(B);
+				printConcept(A, B);
 		}
 	}
 public:
 	Stats stats; // TODO: hackish
 
-	Algorithm():rows(), attributes_(0), objects_(0), min_support_(0),
+	Algorithm():rows(), attributes_(0), objects_(0), min_support_(0), objectsNums(nullptr), objectsStarts(nullptr),
+		object_order_(INPUT), original_attributes_(0), reduce_(false), merge_objects_(false), weights_(nullptr),
 		output_mtx(make_shared<mutex>()), 
-		buf(cout), diag_(&cerr), sort_(false),
-		verbose_(0), threads_(0), par_level_(0){}
+		buf(cout), diag_(&cerr), output_mode_(INTENTS), binary_(false), record_(0, 0),
+		attribute_order_(AttributeOrder::NATURAL),
+		verbose_(0), threads_(0), par_level_(0), top_owner_(false),
+		checkpoint_period_(0), resume_(false), queue_budget_(0),
+		report_(make_shared<StatsReport>()), forked_(false), progress_period_(0), progress_slot_(nullptr),
+		count_concepts_(false){}
 
 	Algorithm(Algorithm&& algo):
 		rows(move(algo.rows)), 
 		attributes_(algo.attributes_), objects_(algo.objects_), 
-		min_support_(algo.min_support_), output_mtx(algo.output_mtx),
+		min_support_(algo.min_support_), objectsNums(algo.objectsNums), objectsStarts(algo.objectsStarts),
+		object_order_(algo.object_order_), original_attributes_(algo.original_attributes_),
+		reduce_(algo.reduce_), merge_objects_(algo.merge_objects_), weights_(algo.weights_),
+		expansions_(move(algo.expansions_)),
+		output_mtx(algo.output_mtx),
 		diag_(algo.diag_), verbose_(algo.verbose_), 
 		threads_(algo.threads_), par_level_(algo.par_level_), 
-		buf(move(algo.buf)), stats(algo.stats){}
+		buf(move(algo.buf)), output_mode_(algo.output_mode_), binary_(algo.binary_), record_(move(algo.record_)),
+		top_(algo.top_), top_owner_(algo.top_owner_), 
+		checkpoint_file_(move(algo.checkpoint_file_)), checkpoint_output_(move(algo.checkpoint_output_)),
+		checkpoint_period_(algo.checkpoint_period_), resume_(algo.resume_),
+		queue_budget_(algo.queue_budget_), numa_(move(algo.numa_)),
+		report_(move(algo.report_)), forked_(algo.forked_), stats_file_(move(algo.stats_file_)),
+		profile_(move(algo.profile_)), profile_file_(move(algo.profile_file_)),
+		progress_period_(algo.progress_period_), progress_(move(algo.progress_)), progress_slot_(algo.progress_slot_),
+		perf_(move(algo.perf_)), count_concepts_(algo.count_concepts_), counts_(move(algo.counts_)), stats(algo.stats){}
 	// clone & reuse most of current algorithm's state but with empty stats
 	template<class Algo>
 	Algo fork()
 	{
 		Algo algo;
-		algo.rows = rows;
+		algo.rows = localRows();
 		algo.attributes_ = attributes_;
 		algo.objects_ = objects_;
 		algo.min_support_ = min_support_;
 		algo.output(buf.output());
 		algo.diag_ = diag_;
-		algo.sort_ = sort_;
+		algo.attribute_order_ = attribute_order_;
 		algo.verbose_ = verbose_;
 		algo.threads_ = threads_;
 		algo.par_level_ = par_level_;
 		algo.props_start = props_start;
 		algo.attributesNums = attributesNums;
 		algo.revMapping = revMapping;
+		algo.objectsNums = objectsNums;
+		algo.objectsStarts = objectsStarts;
+		algo.object_order_ = object_order_;
+		algo.original_attributes_ = original_attributes_;
+		algo.reduce_ = reduce_;
+		algo.merge_objects_ = merge_objects_;
+		algo.weights_ = weights_;
+		algo.expansions_ = expansions_;
 		algo.buf.sync(buf);
 		algo.writer = writer;
+		algo.top_ = top_;
+		algo.numa_ = numa_;
+		algo.report_ = report_;
+		algo.forked_ = true;
+		if(profile_)
+			algo.profile_.reset(new Profile(par_level_ + 1));
+		algo.progress_ = progress_;
+		if(progress_)
+			algo.progress_slot_ = progress_->slot();
+		if(PerfCounters::enabled()) // forks are made on worker threads, count from here on
+			algo.perf_.reset(new PerfCounters(false));
+		algo.count_concepts_ = count_concepts_;
+		algo.output_mode_ = output_mode_;
+		algo.binary_ = binary_;
 		return algo;
 	}
 
 	virtual ~Algorithm(){
-		printStats();
+		if(!report_)
+			return;
+		buf.flush();
+		stats.output_bytes = buf.written();
+		stats.flush_ns = buf.flushTime();
+		if(perf_)
+			stats.perf = perf_->read();
+		{
+			lock_guard<mutex> lock(report_->mtx);
+			report_->workers.emplace_back(forked_ ? currentWorker() : -1, stats);
+			if(profile_){
+				if(!report_->profile)
+					report_->profile.reset(new Profile(par_level_ + 1));
+				*report_->profile += *profile_;
+			}
+			if(forked_) // the root has printed its counts already
+				report_->counts += counts_;
+		}
+		if(!forked_) // forks are gone by now
+			printStats();
+	}
+
+	// Get/set file for JSON report of stats of all threads, empty - none
+	const string& statsFile()const{ return stats_file_; }
+	Algorithm& statsFile(const string& path){
+		stats_file_ = path;
+		return *this;
 	}
 
-	// Get/set sort option
-	bool sortAttrs()const{ return sort_; }
+	// Get/set file for folded stacks of the enumeration tree profile, empty - no profiling
+	const string& profileFile()const{ return profile_file_; }
+	Algorithm& profileFile(const string& path){
+		profile_file_ = path;
+		return *this;
+	}
+
+	// this algorithm runs tasks scheduled at parLevel() rather than the whole tree,
+	// so for profile they start one level deeper
+	void runsTasks(){
+		if(profile_)
+			profile_->base(par_level_ + 1);
+	}
+
+	// Get/set counting mode: concepts are not printed, JSON with their number
+	// and histograms of intent lengths and supports is written to output at the end
+	bool countingConcepts()const{ return count_concepts_; }
+	Algorithm& countConcepts(bool on){
+		count_concepts_ = on;
+		return *this;
+	}
+
+	// Get/set what is printed of each concept
+	OutputMode outputMode()const{ return output_mode_; }
+	Algorithm& outputMode(OutputMode mode){
+		output_mode_ = mode;
+		return *this;
+	}
+
+	// Get/set binary output, see printBinary
+	bool binaryOutput()const{ return binary_; }
+	Algorithm& binaryOutput(bool on){
+		binary_ = on;
+		return *this;
+	}
+
+	// Get/set period of progress reports in seconds, 0 - none
+	double progress()const{ return progress_period_; }
+	Algorithm& progress(double seconds){
+		progress_period_ = seconds;
+		return *this;
+	}
+
+	// a top-level task is queued
+	void countScheduled(){
+		stats.scheduled++;
+		if(progress_)
+			progress_->addTasks(1);
+	}
+
+	// a top-level task is done, for those that don't go through await
+	void countDone(){
+		if(progress_slot_)
+			Progress::Slot::bump(progress_slot_->tasks);
+	}
+
+	// total of top-level tasks is known in advance
+	void countTasks(size_t n){
+		if(progress_)
+			progress_->addTasks(n);
+	}
+
+	// pop a task with fn, counting time spent waiting and tasks run
+	template<class Fn>
+	bool await(Fn&& pop){
+		if(progress_slot_) // all of the tasks taken before are done
+			progress_slot_->tasks.store(stats.ran, memory_order_relaxed);
+		auto beg = chrono::steady_clock::now();
+		bool ok = pop();
+		stats.wait_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - beg).count();
+		stats.ran += ok;
+		return ok;
+	}
+
+	// Get/set sort option, same as ascending order of attributes
+	bool sortAttrs()const{ return attribute_order_ != AttributeOrder::NATURAL; }
 	Algorithm& sortAttrs(bool s){ 
-		sort_ = s;
+		attribute_order_ = s ? AttributeOrder::ASCENDING : AttributeOrder::NATURAL;
+		return *this;
+	}
+
+	// Get/set order of attributes, takes effect on loading data
+	AttributeOrder::Kind attributeOrder()const{ return attribute_order_; }
+	Algorithm& attributeOrder(AttributeOrder::Kind order){
+		attribute_order_ = order;
+		return *this;
+	}
+
+	// Get/set context reduction, takes effect on loading data
+	bool reducing()const{ return reduce_; }
+	Algorithm& reduce(bool on){
+		reduce_ = on;
+		return *this;
+	}
+
+	// Get/set merging of identical objects into one weighted by their number, takes effect on loading data
+	bool mergingObjects()const{ return merge_objects_; }
+	Algorithm& mergeObjects(bool on){
+		merge_objects_ = on;
+		return *this;
+	}
+
+	// Get/set order of objects, takes effect on loading data
+	ObjectOrder objectOrder()const{ return object_order_; }
+	Algorithm& objectOrder(ObjectOrder order){
+		object_order_ = order;
 		return *this;
 	}
 
@@ -199,6 +976,48 @@ public:
 		par_level_ = par_lvl;
 		return *this;
 	}
+	// Get/set memory budget in bytes for tasks queued by parallel algorithms, 0 - unbounded
+	size_t queueBudget()const{ return queue_budget_; }
+	Algorithm& queueBudget(size_t bytes){
+		queue_budget_ = bytes;
+		return *this;
+	}
+
+	// Get/set NUMA mode: worker threads are pinned to CPUs round-robin over nodes,
+	// algorithms forked on a pinned thread read the replica of context of their node
+	bool numa()const{ return numa_ != nullptr; }
+	Algorithm& numa(bool on){
+		numa_ = on ? make_shared<NumaContext>() : nullptr;
+		return *this;
+	}
+
+	// pin calling thread as worker #t, no-op unless in NUMA mode
+	void pinWorker(size_t t){
+		currentWorker() = (int)t;
+		if(!numa_)
+			return;
+		auto& nodes = numa_->nodes;
+		size_t node = t % nodes.size(); // spread over nodes first, for memory bandwidth
+		auto& cpus = nodes[node];
+		if(pinThread(cpus[t / nodes.size() % cpus.size()]))
+			NumaContext::currentNode() = (int)node;
+	}
+
+	// rows to be read by the calling thread
+	IntSet* localRows(){
+		int node = NumaContext::currentNode();
+		if(!numa_ || node < 0)
+			return rows;
+		lock_guard<mutex> lock(numa_->mtx);
+		auto& replica = numa_->rows[node];
+		if(!replica){
+			replica = IntSet::newArray(objects_);
+			for(size_t i = 0; i < objects_; i++)
+				replica[i].copy(rows[i]);
+		}
+		return replica;
+	}
+
 	// Get/set IO buffer size
 	Algorithm& bufferSize(size_t sz){
 		buf.resize(sz);
@@ -225,6 +1044,39 @@ public:
 		filter_ = filt;
 		return *this;
 	}
+	// Set up top-k mode: only k best concepts w.r.t. rank are printed, best first.
+	// Support threshold rises as the top fills up, pruning the rest of enumeration.
+	// Must be called after loading data.
+	Algorithm& topK(size_t k, TopK::Rank rank){
+		top_ = k ? make_shared<TopK>(k, rank, original_attributes_) : nullptr;
+		top_owner_ = k != 0;
+		return *this;
+	}
+
+	// Set up periodic checkpoints to file, consistent with output written to output_path.
+	// With resume set, enumeration continues from the checkpoint in file if there is one,
+	// output file must be already cut down to checkpointedOutput(file) bytes.
+	Algorithm& checkpoint(const string& file, const string& output_path, double period, bool resume){
+		checkpoint_file_ = file;
+		checkpoint_output_ = output_path;
+		checkpoint_period_ = period;
+		resume_ = resume;
+		return *this;
+	}
+	const string& checkpointFile()const{ return checkpoint_file_; }
+	const string& checkpointOutput()const{ return checkpoint_output_; }
+	double checkpointPeriod()const{ return checkpoint_period_; }
+	bool resuming()const{ return resume_; }
+	// if algorithm is able to checkpoint and resume
+	virtual bool resumable()const{ return false; }
+
+	// write out all committed output of this algorithm
+	Algorithm& flushOutput(){
+		buf.flush();
+		return *this;
+	}
+	ostream& outputStream(){ return buf.output(); }
+
 	// Get dimensions of loaded Algorithm
 	size_t attributes()const{ return attributes_; }
 	size_t objects()const{ return objects_; }
@@ -242,7 +1094,30 @@ public:
 
 	// Run specified algorithm with current parameters and data
 	void run(){
+		if(!profile_file_.empty() && !profile_)
+			profile_.reset(new Profile(par_level_ + 1));
+		if(binary_ && verbose() >= 1 && !count_concepts_ && !forked_ && !resume_)
+			printHeader(); // resumed output has it already
+		bool reports = progress_period_ > 0 && !progress_;
+		if(reports){
+			progress_ = make_shared<Progress>(progress_period_, *diag_);
+			progress_slot_ = progress_->slot();
+			progress_->start();
+		}
 		algorithm();
+		if(reports)
+			progress_->stop();
+		if(count_concepts_ && !forked_)
+			printCounts();
+		if(top_owner_){
+			ExtSet A = ExtSet::newEmpty();
+			top_->drain([&](IntSet& B){
+				A.clearAll();
+				if(output_mode_ != INTENTS) // top keeps intents only
+					extentOf(B, A);
+				printConcept(A, B);
+			});
+		}
 		lock_guard<mutex> lock(*output_mtx);
 		buf.flush();
 	}
@@ -266,7 +1141,31 @@ public:
 			attributes_ = max_attribute + 1;
 			props_start = max_attribute + 1; //nowhere
 		}
+		original_attributes_ = attributes_;
+		vector<vector<size_t>> groups; // original objects of each merged object
+		vector<size_t> kept; // original numbers of attributes left by reduction
+		vector<ContextReduction::Removed> removed;
+		if(reduce_){
+			measure([&]{
+				ContextReduction reduction(values, attributes_);
+				kept = reduction.kept();
+				removed = reduction.removed();
+			}, "Reducing context", verbose() > 1);
+			attributes_ = kept.size();
+			if(verbose() > 1)
+				cerr << "Reduced context: " << attributes_ << " of " << original_attributes_ << " attributes" << endl;
+		}
+		size_t original_objects = objects_;
+		if(merge_objects_){
+			measure([&]{
+				groups = ContextReduction::mergeObjects(values);
+			}, "Merging objects", verbose() > 1);
+			objects_ = values.size();
+			if(verbose() > 1)
+				cerr << "Merged objects: " << objects_ << " of " << original_objects << endl;
+		}
 		
+
 		// Count supports and sort Algorithm
 		// May also cut off attributes based on minimal support here and resize accordingly
 		vector<size_t> supps(attributes_);
@@ -279,42 +1178,115 @@ public:
 
 		for (size_t i = 0; i < objects_; i++){
 			for (auto val : values[i]){
-				supps[val]++;
+				supps[val] += groups.empty() ? 1 : groups[i].size();
 			}
 		}
 		if(verbose() > 1){
 			size_t ones = 0;
 			for(size_t i=0; i<attributes_; i++)
 				ones += supps[i];
-			auto density = ones / (double)(attributes_*objects_);
+			auto density = ones / (double)(attributes_*original_objects);
 			cerr << "Density of ones: " << density << endl;
 		}
-		// attributeNums[0] --> least frequent attribute num
-		if(sort_){
-			sort(attributesNums, attributesNums+attributes_, [&](size_t i, size_t j){
-				return supps[i] < supps[j];
-			});
+		// attributeNums[0] --> first attribute to process, least frequent one in ascending order
+		if(attribute_order_ != AttributeOrder::NATURAL){
+			measure([&]{
+				// probes go over merged objects, so minimal support is scaled down to them
+				auto order = AttributeOrder(values, attributes_, supps, min_support_ * objects_ / original_objects)
+					.order(attribute_order_, verbose() > 1 ? diag_ : nullptr);
+				copy(order.begin(), order.end(), attributesNums);
+			}, "Ordering attributes", verbose() > 1);
 		}
 		
-		revMapping = new size_t[attributes_]; // from original to sorted (most frequent --> 0)
+		revMapping = new size_t[attributes_]; // from original to position in order
 		for (size_t i = 0; i < attributes_; i++){
 			revMapping[attributesNums[i]] = i;
 		}
 
-		// Setup Algorithm with re-ordered attributes
+		vector<vector<size_t>> mapped(objects_); // sorted positions of attributes of each object
+		for (size_t i = 0; i < objects_; i++){
+			for (auto val : values[i])
+				mapped[i].push_back(revMapping[val]);
+			sort(mapped[i].begin(), mapped[i].end());
+		}
+		// similar objects go next to each other, extents become runs and rows are read in sequence
+		objectsNums = new size_t[objects_];
+		for (size_t i = 0; i < objects_; i++){
+			objectsNums[i] = i;
+		}
+		if(object_order_ != INPUT){
+			stable_sort(objectsNums, objectsNums+objects_, [&](size_t a, size_t b){
+				return precedes(mapped[a], mapped[b], object_order_ == GRAY);
+			});
+		}
+		if(verbose() > 1){
+			cerr << "Runs of objects in columns: " << columnRuns(mapped) << endl;
+		}
+
+		// Setup Algorithm with re-ordered attributes and objects
 		ExtSet::setSize(objects_);
 		IntSet::setSize(attributes_);
 		rows = IntSet::newArray(objects_);
 		for (size_t i = 0; i < objects_; i++){
 			row(i).clearAll();
-			for (auto val : values[i]){
-				row(i).add(revMapping[val]);
+			for (auto pos : mapped[objectsNums[i]]){
+				row(i).add(pos);
+			}
+		}
+		if(reduce_){
+			// back to original numbers, removed attributes have no position
+			for (size_t i = 0; i < attributes_; i++)
+				attributesNums[i] = kept[attributesNums[i]];
+			delete[] revMapping;
+			revMapping = new size_t[original_attributes_];
+			fill(revMapping, revMapping + original_attributes_, ~(size_t)0);
+			for (size_t i = 0; i < attributes_; i++)
+				revMapping[attributesNums[i]] = i;
+			expansions_ = make_shared<vector<Expansion>>();
+			for(auto& r : removed){
+				IntSet up = IntSet::newEmpty();
+				for(auto a : r.up)
+					up.add(revMapping[kept[a]]);
+				expansions_->push_back({r.attr, move(up)});
+			}
+		}
+		// objects of merged ones are listed one group after another
+		objectsStarts = new size_t[objects_+1];
+		if(groups.empty()){
+			for (size_t i = 0; i <= objects_; i++)
+				objectsStarts[i] = i;
+		}
+		else{
+			vector<size_t> order(objectsNums, objectsNums + objects_);
+			delete[] objectsNums;
+			size_t k = 0;
+			for(auto& g : groups)
+				k += g.size();
+			objectsNums = new size_t[k];
+			k = 0;
+			for (size_t i = 0; i < objects_; i++){
+				objectsStarts[i] = k;
+				for(auto o : groups[order[i]])
+					objectsNums[k++] = o;
+			}
+			objectsStarts[objects_] = k;
+			if(k != objects_){
+				weights_ = new size_t[objects_];
+				for (size_t i = 0; i < objects_; i++)
+					weights_[i] = objectsStarts[i+1] - objectsStarts[i];
 			}
 		}
-		writer = make_shared<IntWriter>(attributes());
+		writer = make_shared<IntWriter>(original_attributes_);
 		return true;
 	}
 
+	// apply fn to original numbers of object i, more than one if identical objects were merged
+	template<class Fn>
+	void eachOriginal(size_t i, Fn&& fn)const{
+		for(size_t k = objectsStarts[i]; k < objectsStarts[i+1]; k++)
+			fn(objectsNums[k]);
+	}
+
 	// get sorted mapping of attribute n
 	size_t mapAttribute(size_t n){
 		return revMapping[n];
@@ -346,40 +1318,108 @@ public:
 		C - empty, D - full
 		Output: C = A intersect closure({j}); D = closure of C
 		Returns: boolean - true if extent passes the minimal support
+		With minimal support set, closure stops as soon as the rest of A
+		can't lift the support up to the minimum (C and D are then partial).
 	*/
 	bool closeConcept(ExtSet& A, size_t y, ExtSet& C, IntSet& D){
-		size_t cnt = 0;
+		if(minSupport()){
+			stats.closures++;
+			return boundedClosure(A, y, C, D);
+		}
 		//cerr << "y = " << y << endl;
 		A.each([&](size_t i){
+			stats.objects++;
 			if (row(i).has(y)){
 				/*cerr << "+++ ";
 				printSet(row(i),cerr);
 				cerr << endl;*/
 				C.add(i);
 				D.intersect(row(i));
-
-				cnt++;
+				stats.intersections++;
 			}
 		});
 		/*cerr << "=== ";
 		printSet(D,cerr);
 		cerr << endl;*/
 		stats.closures++;
-		return cnt >= minSupport();
+		return true;
+	}
+
+	// number of original objects behind object i
+	size_t weight(size_t i)const{
+		return weights_ ? weights_[i] : 1;
+	}
+
+	// support of extent, sum of weights of its objects
+	size_t support(ExtSet& A)const{
+		if(!weights_)
+			return A.count();
+		size_t sup = 0;
+		A.each([&](size_t i){
+			sup += weights_[i];
+		});
+		return sup;
+	}
+
+	// support of extent is at least the minimal one
+	bool supported(ExtSet& A)const{
+		return !min_support_ || support(A) >= min_support_;
+	}
+
+	// closeConcept that gives up once minimal support is out of reach
+	bool boundedClosure(ExtSet& A, size_t y, ExtSet& C, IntSet& D){
+		size_t min_sup = minSupport();
+		size_t left = support(A); // support of objects of A yet to be checked
+		if(left < min_sup)
+			return false;
+		size_t sup = 0; // support of C
+		bool done = A.eachWhile([&](size_t i){
+			size_t w = weight(i);
+			left -= w;
+			stats.objects++;
+			if (row(i).has(y)){
+				C.add(i);
+				sup += w;
+				D.intersect(row(i));
+				stats.intersections++;
+			}
+			return sup + left >= min_sup;
+		});
+		return done && sup >= min_sup;
 	}
 
 	// Produce extent having attribute y from A
 	// true - if produced extent is identical
+	// With minimal support set, C is left partial (below the minimum)
+	// as soon as the rest of A can't lift its support up to the minimum.
 	bool filterExtent(ExtSet& A, size_t y, ExtSet& C){
-		bool ret = true;
-		A.each([&](size_t i){
+		size_t min_sup = minSupport();
+		if(!min_sup){
+			bool ret = true;
+			A.each([&](size_t i){
+				stats.objects++;
+				if (row(i).has(y)){
+					C.add(i);
+				}
+				else
+					ret = false;
+			});
+			return ret;
+		}
+		size_t left = support(A); // support of objects of A yet to be checked
+		if(left < min_sup)
+			return false;
+		size_t sup = 0; // support of C
+		return A.eachWhile([&](size_t i){
+			size_t w = weight(i);
+			left -= w;
+			stats.objects++;
 			if (row(i).has(y)){
 				C.add(i);
+				sup += w;
 			}
-			else
-				ret = false;
-		});
-		return ret;
+			return sup + left >= min_sup;
+		}) && C.count() == A.count();
 	}
 
 	// Close intent over extent C, up to y 
@@ -387,6 +1427,8 @@ public:
 		C.each([&](size_t i){
 			D.intersect(row(i), y);
 		});
+		stats.objects += C.count();
+		stats.intersections += C.count();
 		stats.closures++;
 	}
 
@@ -415,21 +1457,38 @@ struct SimpleState {
 
 	void alloc(Algorithm& algo){}
 	SimpleState& dup(){ return *this; } //nothing to duplicate
+
+	// write compact binary form, see serialize.hpp
+	void save(Encoder& enc){
+		enc.word(j);
+		enc.set(extent, enc.objects());
+		enc.set(intent, enc.attributes());
+	}
+	// read back what save wrote
+	void load(Decoder& dec, Algorithm& algo){
+		j = dec.word();
+		dec.set(extent, algo.objects());
+		dec.set(intent, algo.attributes());
+	}
+	// bytes of memory held
+	size_t footprint()const{
+		return sizeof(*this) + extent.footprint() + intent.footprint();
+	}
 };
 
-// Extended state for algorithms with implied errors array
+// Extended state for algorithms with implied errors, see ImpliedSets
 struct ExtendedState {
 	ExtSet extent;
 	IntSet intent;
 	size_t j; // attribute #
-	CompIntSet* implied; // must be inited
+	ImpliedSets* implied; // layer of the stack, must be inited
 	size_t attributes;
 	bool owns;
 	ExtendedState():extent(), intent(), j(0), implied(nullptr), attributes(0), owns(false){}
-	ExtendedState(ExtSet extent_, IntSet intent_, size_t attr, CompIntSet* implied_, size_t total_attributes):
+	ExtendedState(ExtSet extent_, IntSet intent_, size_t attr, ImpliedSets* implied_, size_t total_attributes):
 		extent(move(extent_)), intent(move(intent_)), j(attr), implied(implied_), attributes(total_attributes), owns(false){}
 
-	ExtendedState(ExtendedState&& state):implied(nullptr)
+	ExtendedState(ExtendedState&& state):implied(nullptr), owns(false)
 	{
 		*this = move(state);
 	}
@@ -440,17 +1499,18 @@ struct ExtendedState {
 		intent = move(state.intent);
 		j = state.j;
 		attributes = state.attributes;
-		if(implied){ // assume we have preallocated implied stack that is X*attributes in size
-			for(size_t i=j; i<state.attributes; i++){ // no point in copying sets < j, recursion goes from j
-				implied[i] = state.implied[i];
-			}
-			owns = state.owns;
-			state.implied = nullptr;
+		if(implied){ // assume we have preallocated stack, implied sets of the task become its first layer
+			if(state.owns)
+				implied[0] = move(*state.implied);
+			else // no point in sharing sets < j, recursion goes from j
+				implied[0].assign(*state.implied, j);
+			state.release();
 		}
 		else{
 			implied = state.implied;
 			owns = state.owns;
 			state.implied = nullptr;
+			state.owns = false;
 		}
 		return *this;
 	}
@@ -458,24 +1518,379 @@ struct ExtendedState {
 	// allocate new stack for implied errors 
 	// (normally state just refrences one layer of common stack)
 	void alloc(Algorithm& algo){
-		implied = new CompIntSet[max((size_t)2, algo.attributes() + 1 - algo.parLevel())*algo.attributes()];
+		implied = new ImpliedSets[algo.attributes() + 1]; // a layer per level of recursion
 		owns = true;
 	}
 
-	// duplicate implied vector
+	// own copy of the layer, sharing the sets
 	ExtendedState& dup(){
-		auto new_implied = new CompIntSet[attributes];
-		copy(implied, implied+attributes, new_implied);
-		implied = new_implied;
+		auto layer = new ImpliedSets[1];
+		layer->assign(*implied, j);
+		release();
+		implied = layer;
 		owns = true;
 		return *this;
 	}
 
+	void release(){
+		if(owns) delete[] implied;
+		implied = nullptr;
+		owns = false;
+	}
+
+	// only implied sets >= j are ever looked at
+	void save(Encoder& enc){
+		enc.word(j);
+		enc.set(extent, enc.objects());
+		enc.set(intent, attributes);
+		implied->save(enc, j);
+	}
+	// implied stack must be allocated
+	void load(Decoder& dec, Algorithm& algo){
+		j = dec.word();
+		attributes = algo.attributes();
+		dec.set(extent, algo.objects());
+		dec.set(intent, attributes);
+		implied->load(dec, j, attributes);
+	}
+	// bytes of memory held, a layer of the stack isn't ours unless duplicated
+	size_t footprint()const{
+		return sizeof(*this) + extent.footprint() + intent.footprint()
+			+ (owns ? implied->footprint() : 0);
+	}
+
 	~ExtendedState(){
-		if(owns) delete[] implied; // if we allocted it delete implied vector
+		release(); // if we allocted it delete implied stack
+	}
+};
+
+
+// Step of the path from the root of a walk to the subtree it is in
+struct PathStep{
+	size_t j;
+	IntSet intent;
+};
+
+// Checkpoint file header: magic and size of output it is consistent with
+enum : size_t { CHECKPOINT_MAGIC = 0x4B43534A }; // "JSCK"
+
+// Size of the output recorded in checkpoint file, 0 if there is no checkpoint
+inline size_t checkpointedOutput(const string& file){
+	vector<unsigned char> data;
+	if(!readFile(file, data) || data.empty())
+		return 0;
+	Decoder dec(data.data());
+	if(dec.word() != CHECKPOINT_MAGIC){
+		cerr << "Not a checkpoint file: " << file << endl;
+		abort();
+	}
+	return dec.word();
+}
+
+template<class State>
+class PathWalk;
+
+// Periodic checkpoints of enumeration. All walks taking part (serial recursion, the producer
+// and the workers of a thread pool) stop at safe points right before entering a subtree,
+// at which point committed output is flushed and fsync'd and the frontier is written:
+//  - for every walk the path of (j, intent) down to the subtree it was about to enter,
+//  with the task a worker was running;
+//  - tasks still queued.
+// Walk without task is the root one, no root walk means it has finished.
+// Resuming replays the paths without output, skipping subtrees that were done.
+template<class State>
+class Checkpoint{
+	using Clock = chrono::steady_clock;
+	// frontier of a walk read from checkpoint
+	struct Frontier{
+		vector<unsigned char> task; // empty for the root walk
+		vector<PathStep> path;
+	};
+	Algorithm& algo_;
+	mutex mtx_;
+	condition_variable work_; // for the queue
+	condition_variable done_; // for the end of checkpoint
+	atomic<bool> requested_;
+	atomic<Clock::rep> due_;
+	size_t participants_, parked_, idle_, generation_;
+	vector<PathWalk<State>*> walks_; // all that take part
+	deque<State> queue_;
+	deque<Frontier> resumed_; // tasks from checkpoint, not started yet
+	bool has_root_; // root walk is not done yet
+	vector<PathStep> root_path_;
+	bool closed_;
+	Encoder enc_, task_enc_;
+
+	void schedule(){
+		auto period = chrono::duration_cast<Clock::duration>(chrono::duration<double>(algo_.checkpointPeriod()));
+		due_ = (Clock::now() + period).time_since_epoch().count();
+	}
+
+	void load(){
+		vector<unsigned char> data;
+		if(!algo_.resuming() || !readFile(algo_.checkpointFile(), data) || data.empty())
+			return;
+		Decoder dec(data.data());
+		dec.word(); // magic, checked along with output size
+		dec.word();
+		has_root_ = false;
+		for(size_t n = dec.word(); n; n--){
+			Frontier f;
+			f.task = dec.block();
+			f.path.resize(dec.word());
+			for(auto& step : f.path){
+				step.j = dec.word();
+				dec.set(step.intent, algo_.attributes());
+			}
+			if(f.task.empty()){
+				has_root_ = true;
+				root_path_ = move(f.path);
+			}
+			else
+				resumed_.push_back(move(f));
+		}
+	}
+
+	void savePath(const vector<PathStep>& path){
+		enc_.word(path.size());
+		for(auto& step : path){
+			enc_.word(step.j);
+			enc_.set(const_cast<IntSet&>(step.intent), algo_.attributes());
+		}
+	}
+
+	// everybody is either parked or waits for work
+	void write(){
+		for(auto w : walks_)
+			w->flush();
+		auto& out = algo_.outputStream();
+		out.flush();
+		size_t offset = (size_t)out.tellp();
+		if(!syncFile(algo_.checkpointOutput())){
+			cerr << "Failed to sync output " << algo_.checkpointOutput() << endl;
+			abort();
+		}
+		enc_.clear();
+		enc_.word(CHECKPOINT_MAGIC);
+		enc_.word(offset);
+		size_t walks = resumed_.size() + queue_.size();
+		for(auto w : walks_)
+			walks += w->parked();
+		enc_.word(walks);
+		for(auto w : walks_)
+			if(w->parked())
+				w->save(enc_);
+		for(auto& f : resumed_){
+			enc_.block(f.task);
+			savePath(f.path);
+		}
+		for(auto& s : queue_){
+			task_enc_.clear();
+			s.save(task_enc_);
+			enc_.block(task_enc_.bytes());
+			enc_.word(0);
+		}
+		if(!replaceFile(algo_.checkpointFile(), enc_.bytes())){
+			cerr << "Failed to write checkpoint " << algo_.checkpointFile() << endl;
+			abort();
+		}
+		if(algo_.verbose() > 1)
+			cerr << "Checkpoint: " << walks << " tasks, " << offset << " bytes of output" << endl;
+	}
+
+	// called with lock held whenever a walk stops
+	void arrive(){
+		if(requested_ && parked_ + idle_ == participants_){
+			write();
+			requested_ = false;
+			schedule();
+			generation_++;
+			done_.notify_all();
+			work_.notify_all();
+		}
+	}
+public:
+	explicit Checkpoint(Algorithm& algo):
+		algo_(algo), requested_(false), participants_(0), parked_(0), idle_(0), generation_(0),
+		has_root_(true), closed_(false), enc_(algo.objects(), algo.attributes()),
+		task_enc_(algo.objects(), algo.attributes()){
+		load();
+		schedule();
+	}
+
+	// root walk is still to be done (or continued from rootPath)
+	bool hasRoot()const{ return has_root_; }
+	vector<PathStep> rootPath(){ return move(root_path_); }
+
+	void join(PathWalk<State>& walk){
+		lock_guard<mutex> lock(mtx_);
+		walks_.push_back(&walk);
+		participants_++;
+	}
+
+	void leave(PathWalk<State>& walk){
+		walk.flush();
+		lock_guard<mutex> lock(mtx_);
+		walks_.erase(find(walks_.begin(), walks_.end(), &walk));
+		participants_--;
+		arrive();
+	}
+
+	// stop here if a checkpoint is due, walk must be ready to save its frontier
+	void safePoint(PathWalk<State>& walk){
+		if(!requested_.load(memory_order_relaxed)){
+			if(Clock::now().time_since_epoch().count() < due_.load(memory_order_relaxed))
+				return;
+		}
+		unique_lock<mutex> lock(mtx_);
+		requested_ = true;
+		size_t gen = generation_;
+		walk.park(true);
+		parked_++;
+		arrive();
+		done_.wait(lock, [&]{ return generation_ != gen; });
+		parked_--;
+		walk.park(false);
+	}
+
+	void push(State&& state){
+		lock_guard<mutex> lock(mtx_);
+		queue_.push_back(move(state));
+		work_.notify_one();
+	}
+
+	// no more tasks from the root walk
+	void close(){
+		lock_guard<mutex> lock(mtx_);
+		closed_ = true;
+		has_root_ = false;
+		work_.notify_all();
+	}
+
+	// next task for the walk, false once all is done
+	bool pop(State& state, PathWalk<State>& walk){
+		unique_lock<mutex> lock(mtx_);
+		idle_++;
+		arrive();
+		work_.wait(lock, [&]{
+			return !requested_ && (!resumed_.empty() || !queue_.empty() || (closed_ && !has_root_));
+		});
+		idle_--;
+		if(!resumed_.empty()){
+			Frontier f = move(resumed_.front());
+			resumed_.pop_front();
+			lock.unlock();
+			Decoder dec(f.task.data());
+			state.load(dec, algo_);
+			walk.start(move(f.path), move(f.task));
+			return true;
+		}
+		if(!queue_.empty()){
+			state = move(queue_.front());
+			queue_.pop_front();
+			lock.unlock();
+			walk.start(state);
+			return true;
+		}
+		return false;
+	}
+
+	// all done, checkpoint is no longer needed
+	void finish(){
+		algo_.flushOutput();
+		algo_.outputStream().flush();
+		remove(algo_.checkpointFile().c_str());
+	}
+};
+
+// Tracks the path of a walk for checkpoints and replays the path when resuming
+template<class State>
+class PathWalk{
+	Checkpoint<State>& cp_;
+	Algorithm& algo_; // whose output it is
+	vector<State*> path_; // subtrees entered, outermost first
+	vector<PathStep> resume_; // path to replay
+	vector<unsigned char> task_; // serialized task being run, empty for the root walk
+	Encoder enc_;
+	bool replaying_, parked_;
+public:
+	PathWalk(Checkpoint<State>& cp, Algorithm& algo):
+		cp_(cp), algo_(algo), enc_(algo.objects(), algo.attributes()), replaying_(false), parked_(false){}
+
+	// (re)start walk from the root or the task, following resume path if not empty
+	void start(vector<PathStep> resume, vector<unsigned char> task = {}){
+		path_.clear();
+		resume_ = move(resume);
+		task_ = move(task);
+		replaying_ = !resume_.empty();
+	}
+	// start walk of a new task
+	void start(State& task){
+		enc_.clear();
+		task.save(enc_);
+		start({}, enc_.bytes());
+	}
+
+	// output is suppressed while replaying, it has been written before
+	bool replaying()const{ return replaying_; }
+
+	// true if the subtree was done before the checkpoint
+	bool skip(State& s){
+		if(!replaying_)
+			return false;
+		auto& step = resume_[path_.size()];
+		if(s.j < step.j)
+			return true;
+		if(s.j > step.j || !s.intent.subsetOf(step.intent, algo_.attributes())){
+			cerr << "Checkpoint doesn't match the data" << endl;
+			abort();
+		}
+		if(path_.size() + 1 == resume_.size()) // where the walk has stopped
+			replaying_ = false;
+		return false;
+	}
+
+	void enter(State& s){
+		path_.push_back(&s);
+		if(!replaying_)
+			cp_.safePoint(*this);
+	}
+	void leave(){ path_.pop_back(); }
+	size_t depth()const{ return path_.size(); }
+
+	// for the Checkpoint
+	void park(bool p){ parked_ = p; }
+	bool parked()const{ return parked_; }
+	void flush(){ algo_.flushOutput(); }
+	void save(Encoder& enc){
+		enc.block(task_);
+		enc.word(path_.size());
+		for(auto s : path_){
+			enc.word(s->j);
+			enc.set(s->intent, algo_.attributes());
+		}
 	}
 };
 
+// Apply memory budget of the algorithm to its queue of tasks.
+// Without spilling producers wait for consumers once the budget is exhausted.
+template<class State>
+void boundQueue(SharedQueue<State>& queue, Algorithm& algo, bool spill){
+	if(!algo.queueBudget())
+		return;
+	queue.bound(algo.queueBudget(), [](State& s){ return s.footprint(); });
+	if(spill){
+		Algorithm* a = &algo;
+		queue.spillWith([a](State& s, vector<unsigned char>& bytes){
+			Encoder enc(a->objects(), a->attributes());
+			s.save(enc);
+			bytes = enc.bytes();
+		}, [a](const vector<unsigned char>& bytes, State& s){
+			Decoder dec(bytes.data());
+			s.load(dec, *a);
+		});
+	}
+}
 
 // plain strategy that doesn't schedule threads
 class RecursiveStrategy{
@@ -507,8 +1922,49 @@ template<class GenericAlgo>
 class RecursiveCalls: public GenericAlgo, public RecursiveStrategy {
 public:
 	using State = typename GenericAlgo::State;
+private:
+	PathWalk<State>* walk_; // set while checkpointing
+protected:
+	void output(ExtSet& A, IntSet& B){
+		if(!walk_ || !walk_->replaying())
+			Algorithm::output(A, B);
+	}
+	void algorithm(){
+		if(this->checkpointFile().empty()){
+			GenericAlgo::algorithm();
+			return;
+		}
+		Checkpoint<State> cp(*this);
+		if(cp.hasRoot()){
+			PathWalk<State> walk(cp, *this);
+			cp.join(walk);
+			walk.start(cp.rootPath());
+			walk_ = &walk;
+			GenericAlgo::algorithm();
+			walk_ = nullptr;
+			cp.leave(walk);
+		}
+		cp.finish();
+	}
+public:
+	using GenericAlgo::run;
+	void output(ostream& os){ Algorithm::output(os); }
+	RecursiveCalls():walk_(nullptr){}
+	bool resumable()const{ return true; }
 	void processQueueItem(State&& s){
-		RecursiveStrategy::processQueueItem(this, s);
+		if(!walk_)
+			RecursiveStrategy::processQueueItem(this, s);
+		else if(!walk_->skip(s)){
+			walk_->enter(s);
+			this->run(s);
+			walk_->leave();
+		}
+	}
+	// run task as a part of checkpointed walk
+	void run(State& s, PathWalk<State>& walk){
+		walk_ = &walk;
+		this->run(s);
+		walk_ = nullptr;
 	}
 };
 
@@ -535,12 +1991,14 @@ private:
 		measure([&]{
 			for (size_t t = 0; t < threads(); t++){
 				trds[t] = thread([this, t]{
+					pinWorker(t);
 					State state;
 					state.extent = ExtSet::newEmpty();
 					state.intent = IntSet::newEmpty();
 					state.alloc(*this);
 					auto sub = fork<SerialAlgo>();
-					while (extract(t, state)){
+					sub.runsTasks();
+					while (sub.await([&]{ return extract(t, state); })){
 						sub.run(state);
 					}
 					//state.dispose();
@@ -573,6 +2031,7 @@ private:
 public:
 	void schedule(State state){
 		static int tid = 0;
+		countScheduled();
 		queues[tid].push(move(state));
 		tid += 1;
 		if (tid == threads())
@@ -589,42 +2048,46 @@ public:
 	using State = typename GenericAlgo::State;
 	using GenericAlgo::GenericAlgo;
 private:
-	SyncronizedQueue<State> queue;
+	SharedQueue<State> queue;
 
 	// generic parallel algorithm using serialStep and base algorithm for each sub-task
 	void algorithm(){
+		boundQueue(queue, *this, true); // nobody takes tasks during serial step, have to spill
 		measure([&]{
 			serial();
 		}, "Serial step", verbose() > 1);
+		queue.close();
 		// start of multi-threaded part
 		if(threads()){
 			size_t tpool_size = threads()-1;
 			vector<thread> trds(tpool_size);
 			measure([&]{
 				for (size_t t = 0; t < tpool_size; t++){
-					trds[t] = thread([this]{ workThread();	});
+					trds[t] = thread([this, t]{ workThread(t+1); });
 				}
 			}, "Starting threads", verbose() > 1);
-			workThread();
+			workThread(0);
 			for (auto & t : trds){
 				t.join();
 			}
 		}
 		else
-			workThread();
+			workThread(0);
 	}
 
 	void processQueueItem(State&& s){
 		SchedulingCutoffStrategy::processQueueItem(this, s);
 	}
 
-	void workThread(){
+	void workThread(size_t t){
+		pinWorker(t); // before allocating anything, for first touch on its node
 		State state;
 		state.extent = ExtSet::newEmpty();
 		state.intent = IntSet::newEmpty();
 		state.alloc(*this);
 		auto sub = fork<SerialAlgo>();
-		while (queue.pop(state)){
+		sub.runsTasks();
+		while (sub.await([&]{ return queue.pop(state); })){
 			sub.run(state);
 		}
 		//state.dispose();
@@ -634,6 +2097,7 @@ private:
 	}
 public:
 	void schedule(State&& state){
+		countScheduled();
 		queue.push(move(state));
 	}
 
@@ -647,14 +2111,21 @@ public:
 	using GenericAlgo::GenericAlgo;
 private:
 	SharedQueue<State> queue;
+	Checkpoint<State>* cp_; // set while checkpointing
+	PathWalk<State>* walk_; // of the serial step while checkpointing
 
 	void algorithm(){
+		if(!checkpointFile().empty()){
+			checkpointed();
+			return;
+		}
+		boundQueue(queue, *this, threads() < 2); // wait for the pool if there is one
 		if(threads()){
 			size_t tpool_size = threads()-1;
 			vector<thread> trds(tpool_size);
 			measure([&]{
 				for (size_t t = 0; t < tpool_size; t++){
-					trds[t] = thread([this]{ workThread(); });
+					trds[t] = thread([this, t]{ workThread(t+1); });
 				}
 			}, "Starting threads", verbose() > 1);
 			mainThread();
@@ -671,16 +2142,18 @@ private:
 		measure([&]{
 			serial();
 		}, "Serial step", verbose() > 1);
-		workThread();
+		workThread(0);
 	}
 
-	void workThread(){
+	void workThread(size_t t){
+		pinWorker(t); // before allocating anything, for first touch on its node
 		State state;
 		state.extent = ExtSet::newEmpty();
 		state.intent = IntSet::newEmpty();
 		state.alloc(*this);
 		auto sub = fork<SerialAlgo>();
-		while (queue.pop(state)){
+		sub.runsTasks();
+		while (sub.await([&]{ return queue.pop(state); })){
 				sub.run(state);
 		}
 		//state.dispose();
@@ -692,32 +2165,134 @@ private:
 	}
 
 	void processQueueItem(State&& s){
-		SchedulingCutoffStrategy::processQueueItem(this, s);
+		if(!walk_)
+			SchedulingCutoffStrategy::processQueueItem(this, s);
+		else if(!walk_->skip(s)){
+			walk_->enter(s);
+			if(walk_->depth() > parLevel()){
+				countScheduled();
+				cp_->push(move(s.dup()));
+			}
+			else
+				GenericAlgo::run(s);
+			walk_->leave();
+		}
+	}
+
+	// same as above but all threads stop for checkpoints now and then
+	void checkpointed(){
+		Checkpoint<State> cp(*this);
+		cp_ = &cp;
+		vector<thread> trds;
+		for (size_t t = 1; t < threads(); t++)
+			trds.emplace_back([this, &cp, t]{ checkpointedWorker(cp, t); });
+		if(cp.hasRoot()){
+			measure([&]{
+				PathWalk<State> walk(cp, *this);
+				cp.join(walk);
+				walk.start(cp.rootPath());
+				walk_ = &walk;
+				GenericAlgo::algorithm(); //serial step
+				walk_ = nullptr;
+				cp.leave(walk);
+			}, "Serial step", verbose() > 1);
+		}
+		cp.close();
+		checkpointedWorker(cp, 0);
+		for (auto & t : trds)
+			t.join();
+		cp.finish();
+		cp_ = nullptr;
+	}
+
+	void checkpointedWorker(Checkpoint<State>& cp, size_t t){
+		pinWorker(t);
+		State state;
+		state.extent = ExtSet::newEmpty();
+		state.intent = IntSet::newEmpty();
+		state.alloc(*this);
+		auto sub = fork<SerialAlgo>();
+		sub.runsTasks();
+		PathWalk<State> walk(cp, sub);
+		cp.join(walk);
+		while (sub.await([&]{ return cp.pop(state, walk); }))
+			sub.run(state, walk);
+		cp.leave(walk);
+	}
+protected:
+	void output(ExtSet& A, IntSet& B){
+		if(!walk_ || !walk_->replaying())
+			Algorithm::output(A, B);
 	}
 public:
+	void output(ostream& os){ Algorithm::output(os); }
+	WithThreadPool():cp_(nullptr), walk_(nullptr){}
+	bool resumable()const{ return true; }
 	void schedule(State&& state){
+		countScheduled();
 		queue.push(move(state));
 	}
 
 };
 
+// Guided self-scheduling of wave-front subtrees:
+// ranks claim chunks of subtree numbers, chunks shrink as the work runs out.
+class GuidedClaims{
+	atomic<size_t> next_;
+	size_t total_; // total number of subtrees
+	size_t ranks_;
+public:
+	GuidedClaims(size_t total, size_t ranks):next_(0), total_(total), ranks_(max((size_t)1, ranks)){}
+	// claim next chunk [begin, end) of subtrees, begin >= total means no more work
+	pair<size_t, size_t> claim(){
+		size_t next = next_.load();
+		for(;;){
+			size_t left = next < total_ ? total_ - next : 0;
+			size_t chunk = max((size_t)1, left / (2*ranks_));
+			if(next_.compare_exchange_weak(next, next + chunk))
+				return make_pair(next, next + chunk);
+		}
+	}
+};
+
+// One rank of wave-front execution: every rank replays the serial prefix of recursion
+// and runs only the subtrees at parLevel() that it owns. Subtrees are numbered in order
+// of the prefix walk, which is the same for all ranks.
+// Ownership is either static (every waveSize-th subtree) or dynamic via claim function
+// that hands out chunks of subtree numbers not below the current one.
 template<class GenericAlgo>
 class WaveFrontSingle : public GenericAlgo {
 	using State = typename GenericAlgo::State;
 	size_t rank_, waveSize_;
 	size_t counter_, rec_depth_;
+	size_t chunk_begin_, chunk_end_; // owned subtrees in dynamic mode
+	bool prints_prefix_; // print concepts of the serial prefix
+	function<pair<size_t, size_t>()> claim_;
+
+	bool owns(){
+		if(!claim_)
+			return counter_ % waveSize_ == rank_;
+		// claim only on reaching the end of own chunk, so the next one can't start behind us
+		if(counter_ == chunk_end_)
+			tie(chunk_begin_, chunk_end_) = claim_();
+		return counter_ >= chunk_begin_;
+	}
+
 	void processQueueItem(State&& s){
 		if(rec_depth_  == this->parLevel())
 		{
-			if(counter_ == rank_)
+			if(owns())
 			{
+				this->stats.ran++;
+				// raised threshold (top-k) must not leak into the prefix, it has to be the same for all ranks
+				size_t min_sup = this->minSupport();
 				rec_depth_++;
 				GenericAlgo::run(s);
 				rec_depth_--;
+				this->minSupport(min_sup);
+				this->countDone();
 			}
 			counter_++;
-			if(counter_ == waveSize_)
-				counter_ = 0;
 		}
 		else
 		{
@@ -728,18 +2303,35 @@ class WaveFrontSingle : public GenericAlgo {
 	}
 protected:
 	void output(ExtSet& A, IntSet& B){
-		if(rank_ == 0 || rec_depth_ >= this->parLevel())
+		if(rec_depth_ > this->parLevel()){
 			Algorithm::output(A, B);
+		}
+		else if(prints_prefix_){
+			size_t min_sup = this->minSupport();
+			Algorithm::output(A, B);
+			this->minSupport(min_sup);
+		}
 	}
 public:
 	void output(ostream& os){ Algorithm::output(os); }
 	void run(){ Algorithm::run(); }
 	WaveFrontSingle():
-		Algorithm(),rank_(0),waveSize_(0), counter_(0),rec_depth_(0){}
+		Algorithm(),rank_(0),waveSize_(1), counter_(0),rec_depth_(0),
+		chunk_begin_(0), chunk_end_(0), prints_prefix_(true){}
 	//
-	WaveFrontSingle& rank(size_t r){ rank_  = r; return *this; }
+	WaveFrontSingle& rank(size_t r){ rank_  = r; prints_prefix_ = r == 0; return *this; }
 	//
 	WaveFrontSingle& waveSize(size_t ws){ waveSize_  = ws; return *this; }
+	// Set dynamic ownership: claim returns next chunk of subtrees [begin, end) for this rank
+	WaveFrontSingle& claims(function<pair<size_t, size_t>()> claim){ claim_ = claim; return *this; }
+	// Only walk the prefix and count subtrees, don't run any of them
+	WaveFrontSingle& countOnly(){
+		return claims([]{ return make_pair(~(size_t)0, ~(size_t)0); });
+	}
+	// Get/set whether concepts of the serial prefix are printed by this rank
+	WaveFrontSingle& printsPrefix(bool p){ prints_prefix_ = p; return *this; }
+	// number of subtrees at parLevel() walked so far
+	size_t subtrees()const{ return counter_; }
 };
 
 template<class GenericAlgo>
@@ -750,7 +2342,8 @@ class WaveFrontParallel : public Algorithm {
 		auto this_ = this;
 		for(size_t i =0; i<total; i++){
 			thrds.emplace_back([i, total, this_]{
-				auto algo = this_->fork<WaveFrontSingle<GenericAlgo>>();
+				this_->pinWorker(i);
+				auto algo = this_->template fork<WaveFrontSingle<GenericAlgo>>();
 				algo.rank(i);
 				algo.waveSize(total);
 				algo.run();
@@ -763,3 +2356,32 @@ public:
 	using Algorithm::Algorithm;
 };
 
+// Wave-front with dynamic load balancing: one serial walk of the prefix counts subtrees
+// (and prints the prefix), then threads claim chunks of subtrees with guided self-scheduling
+template<class GenericAlgo>
+class WaveFrontDynamic : public Algorithm {
+	void algorithm(){
+		size_t subtrees = 0;
+		measure([&]{
+			auto algo = this->template fork<WaveFrontSingle<GenericAlgo>>();
+			algo.countOnly().run();
+			subtrees = algo.subtrees();
+		}, "Serial step", verbose() > 1);
+		countTasks(subtrees);
+		GuidedClaims claims(subtrees, threads());
+		vector<thread> thrds;
+		for(size_t i =0; i<threads(); i++){
+			thrds.emplace_back([this, &claims, i]{
+				pinWorker(i);
+				auto algo = this->template fork<WaveFrontSingle<GenericAlgo>>();
+				algo.printsPrefix(false);
+				algo.claims([&claims]{ return claims.claim(); });
+				algo.run();
+			});
+		}
+		for(auto& t : thrds)
+			t.join();
+	}
+public:
+	using Algorithm::Algorithm;
+};
@@ -3,22 +3,378 @@
 */
 #pragma once
 #include "algorithm.hpp"
+#include <deque>
+#include <random>
 #include <boost/mpi.hpp>
 
 namespace mpi = boost::mpi;
 
+// MPI is up from the first call till exit, so that results can be reduced after algorithm()
+inline mpi::communicator& mpiWorld(){
+	static mpi::environment env;
+	static mpi::communicator world;
+	return world;
+}
+
+// sum histogram up on rank 0, it may be of different length on each rank
+inline void reduceHistogram(mpi::communicator& world, vector<uint64_t>& hist){
+	size_t n = mpi::all_reduce(world, hist.size(), mpi::maximum<size_t>());
+	hist.resize(n);
+	vector<uint64_t> sum(n);
+	mpi::reduce(world, hist.data(), (int)n, sum.data(), std::plus<uint64_t>(), 0);
+	hist.swap(sum);
+}
+
+// counts of all ranks summed up on rank 0, workers there are ranks with concepts each found
+inline bool reduceCountsMPI(ConceptCounts& counts, vector<pair<int, uint64_t>>& workers){
+	auto& world = mpiWorld();
+	vector<uint64_t> found;
+	mpi::gather(world, counts.total(), found, 0);
+	reduceHistogram(world, counts.lengths());
+	reduceHistogram(world, counts.supports());
+	workers.clear();
+	for(size_t r=0; r<found.size(); r++)
+		workers.emplace_back((int)r, found[r]);
+	return world.rank() == 0;
+}
+
 template<class GenericAlgo>
 class WaveFrontMPI: public Algorithm {
 	void algorithm(){
-		mpi::environment env;
-  		mpi::communicator world;
-		
-		auto algo = this->fork<WaveFrontSingle<GenericAlgo>>();
+		auto& world = mpiWorld();
+		currentWorker() = world.rank();
+
+		auto algo = this->template fork<WaveFrontSingle<GenericAlgo>>();
 		algo.rank(world.rank());
 		algo.waveSize(world.size());
 		algo.run();
 	}
+
+	bool reduceCounts(ConceptCounts& counts, vector<pair<int, uint64_t>>& workers){
+		return reduceCountsMPI(counts, workers);
+	}
+public:
+	using Algorithm::Algorithm;
+};
+
+
+// Wave-front with dynamic load balancing over MPI: rank 0 walks the prefix to count subtrees
+// (printing the prefix) and then hands out chunks of subtrees to the rest of ranks on request
+template<class GenericAlgo>
+class WaveFrontDynamicMPI: public Algorithm {
+	enum { TAG_CLAIM = 1, TAG_CHUNK, TAG_DONE };
+
+	void coordinate(mpi::communicator& world){
+		size_t subtrees = 0;
+		measure([&]{
+			auto algo = this->template fork<WaveFrontSingle<GenericAlgo>>();
+			algo.countOnly().run();
+			subtrees = algo.subtrees();
+		}, "Serial step", verbose() > 1);
+		size_t workers = world.size() - 1;
+		GuidedClaims claims(subtrees, workers);
+		// workers report after their last claim, so no message is left unanswered
+		for(size_t done = 0; done < workers; ){
+			mpi::status st = world.recv(mpi::any_source, mpi::any_tag);
+			if(st.tag() == TAG_CLAIM){
+				auto chunk = claims.claim();
+				size_t msg[2] = { chunk.first, chunk.second };
+				world.send(st.source(), TAG_CHUNK, msg, 2);
+			}
+			else
+				done++;
+		}
+	}
+
+	void work(mpi::communicator& world){
+		auto algo = this->template fork<WaveFrontSingle<GenericAlgo>>();
+		algo.printsPrefix(false);
+		algo.claims([&world]{
+			size_t msg[2];
+			world.send(0, TAG_CLAIM);
+			world.recv(0, TAG_CHUNK, msg, 2);
+			return make_pair(msg[0], msg[1]);
+		});
+		algo.run();
+		world.send(0, TAG_DONE);
+	}
+
+	void algorithm(){
+		auto& world = mpiWorld();
+		currentWorker() = world.rank();
+
+		if(world.size() < 2){ // nobody to hand out work to
+			auto algo = this->template fork<WaveFrontSingle<GenericAlgo>>();
+			algo.run();
+		}
+		else if(world.rank() == 0)
+			coordinate(world);
+		else
+			work(world);
+	}
+
+	bool reduceCounts(ConceptCounts& counts, vector<pair<int, uint64_t>>& workers){
+		return reduceCountsMPI(counts, workers);
+	}
 public:
 	using Algorithm::Algorithm;
 };
 
+// Distributed work stealing: each process keeps a deque of serialized tasks,
+// an idle process asks random victims for work and gets half of their deque.
+// A busy process with empty deque hands over the next subtree it was about to recurse into.
+// Tasks travel in compact binary form (serialize.hpp).
+// Termination is detected by Safra's token ring: work messages are counted
+// and a process turns black on receiving one, rank 0 stops all processes once
+// a white token comes back with zero messages in transit.
+template<class State>
+class TaskStealing{
+	enum { TAG_STEAL = 1, TAG_WORK, TAG_NONE, TAG_TOKEN, TAG_STOP };
+	enum { POLL_PERIOD = 16 }; // check for messages once in this many calls
+	mpi::communicator& world_;
+	Algorithm& algo_;
+	deque<vector<unsigned char>> tasks_; // serialized states
+	Encoder enc_;
+	vector<int> thieves_; // ranks waiting for our reply
+	long balance_; // work messages sent - received
+	bool black_; // received work since the token last passed
+	bool has_token_;
+	long token_count_;
+	bool token_black_;
+	size_t ticks_;
+	mt19937 rng_;
+	vector<unsigned char> buf_;
+	size_t received_; // tasks got from other processes
+
+	// [tasks count] ([length] [task])*
+	void sendTasks(int dest, size_t n){
+		enc_.clear();
+		enc_.word(n);
+		for(size_t i=0; i<n; i++){
+			enc_.block(tasks_.front());
+			tasks_.pop_front();
+		}
+		auto& buf = enc_.bytes();
+		world_.send(dest, TAG_WORK, buf.data(), (int)buf.size());
+		balance_++;
+	}
+
+	void recvTasks(int src){
+		mpi::status st = world_.probe(src, TAG_WORK);
+		buf_.resize(*st.count<unsigned char>());
+		world_.recv(src, TAG_WORK, buf_.data(), (int)buf_.size());
+		balance_--;
+		black_ = true;
+		Decoder dec(buf_.data());
+		for(size_t n = dec.word(); n; n--){
+			tasks_.push_back(dec.block());
+			received_++;
+		}
+	}
+
+	// serve a steal request from a busy process
+	void steal(int thief){
+		if(tasks_.empty())
+			thieves_.push_back(thief); // until we get to split or run out of work
+		else
+			sendTasks(thief, (tasks_.size() + 1) / 2);
+	}
+
+	void recvToken(int src){
+		long msg[2];
+		world_.recv(src, TAG_TOKEN, msg, 2);
+		token_count_ = msg[0];
+		token_black_ = msg[1] != 0;
+		has_token_ = true;
+	}
+
+	// pass the token on, only while idle; true if rank 0 detected termination
+	bool passToken(){
+		if(!has_token_)
+			return false;
+		if(world_.rank() == 0){
+			if(!token_black_ && !black_ && token_count_ + balance_ == 0){
+				for(int r=1; r<world_.size(); r++)
+					world_.send(r, TAG_STOP);
+				return true;
+			}
+			token_count_ = 0; // start new round
+			token_black_ = false;
+		}
+		else{
+			token_count_ += balance_;
+			token_black_ = token_black_ || black_;
+		}
+		long msg[2] = { token_count_, token_black_ };
+		world_.send((world_.rank() + 1) % world_.size(), TAG_TOKEN, msg, 2);
+		black_ = false;
+		has_token_ = false;
+		return false;
+	}
+
+	int victim(){
+		int r = uniform_int_distribution<int>(0, world_.size() - 2)(rng_);
+		return r >= world_.rank() ? r + 1 : r;
+	}
+
+	// wait for work while serving requests of others, false on termination
+	bool idle(){
+		for(int t : thieves_)
+			world_.send(t, TAG_NONE);
+		thieves_.clear();
+		if(world_.size() < 2)
+			return false;
+		if(passToken())
+			return false;
+		world_.send(victim(), TAG_STEAL);
+		for(;;){
+			mpi::status st = world_.probe(mpi::any_source, mpi::any_tag);
+			switch(st.tag()){
+			case TAG_STEAL:
+				world_.recv(st.source(), TAG_STEAL);
+				world_.send(st.source(), TAG_NONE);
+				break;
+			case TAG_NONE:
+				world_.recv(st.source(), TAG_NONE);
+				world_.send(victim(), TAG_STEAL);
+				break;
+			case TAG_WORK:
+				recvTasks(st.source());
+				return true;
+			case TAG_TOKEN:
+				recvToken(st.source());
+				if(passToken())
+					return false;
+				break;
+			case TAG_STOP:
+				world_.recv(st.source(), TAG_STOP);
+				return false;
+			}
+		}
+	}
+public:
+	TaskStealing(mpi::communicator& world, Algorithm& algo):
+		world_(world), algo_(algo), enc_(algo.objects(), algo.attributes()), balance_(0), black_(false), has_token_(world.rank() == 0),
+		token_count_(0), token_black_(true), ticks_(0), rng_(world.rank()), received_(0){}
+
+	// number of tasks stolen from other processes
+	size_t stolen()const{ return received_; }
+
+	// queue task for local execution or stealing
+	void push(State& s){
+		enc_.clear();
+		s.save(enc_);
+		tasks_.emplace_back(enc_.bytes());
+	}
+
+	// next task to run locally, newest first; false once all processes ran out of work
+	bool pop(State& s){
+		while(tasks_.empty())
+			if(!idle())
+				return false;
+		Decoder dec(tasks_.back().data());
+		s.load(dec, algo_);
+		tasks_.pop_back();
+		return true;
+	}
+
+	// serve requests that came in while busy
+	void poll(){
+		if(++ticks_ % POLL_PERIOD)
+			return;
+		while(auto st = world_.iprobe(mpi::any_source, mpi::any_tag)){
+			if(st->tag() == TAG_STEAL){
+				world_.recv(st->source(), TAG_STEAL);
+				steal(st->source());
+			}
+			else // TAG_TOKEN, the only other message to reach a busy process
+				recvToken(st->source());
+		}
+	}
+
+	// some process waits for us to split off work
+	bool hungry(){
+		poll();
+		return !thieves_.empty();
+	}
+
+	// give task away to a waiting process instead of running it
+	void give(State& s){
+		enc_.clear();
+		s.save(enc_);
+		tasks_.emplace_front(enc_.bytes());
+		sendTasks(thieves_.back(), 1);
+		thieves_.pop_back();
+	}
+};
+
+// Serial algorithm that hands subtrees over to idle processes
+template<class GenericAlgo>
+class StealingSingle : public GenericAlgo {
+	using State = typename GenericAlgo::State;
+	TaskStealing<State>* tasks_;
+
+	void processQueueItem(State&& s){
+		if(tasks_->hungry())
+			tasks_->give(s);
+		else
+			GenericAlgo::run(s);
+	}
+public:
+	using GenericAlgo::run;
+	void run(){ Algorithm::run(); }
+	StealingSingle():tasks_(nullptr){}
+	StealingSingle& tasks(TaskStealing<State>* t){ tasks_ = t; return *this; }
+};
+
+// MPI with work stealing: rank 0 runs serial step down to parLevel() queuing the rest as tasks,
+// which are then spread among processes on demand and split further while being executed
+template<class GenericAlgo>
+class WorkStealingMPI : public GenericAlgo {
+	using State = typename GenericAlgo::State;
+	TaskStealing<State>* tasks_;
+	size_t rec_depth_;
+
+	void processQueueItem(State&& s){
+		if(rec_depth_ == this->parLevel()){
+			this->countScheduled();
+			tasks_->push(s);
+			tasks_->poll();
+		}
+		else{
+			rec_depth_++;
+			GenericAlgo::run(s);
+			rec_depth_--;
+		}
+	}
+
+	void algorithm(){
+		auto& world = mpiWorld();
+		Algorithm::currentWorker() = world.rank();
+
+		TaskStealing<State> tasks(world, *this);
+		tasks_ = &tasks;
+		if(world.rank() == 0){
+			measure([&]{
+				GenericAlgo::algorithm();
+			}, "Serial step", this->verbose() > 1);
+		}
+		State state;
+		state.extent = ExtSet::newEmpty();
+		state.intent = IntSet::newEmpty();
+		state.alloc(*this);
+		auto sub = this->template fork<StealingSingle<GenericAlgo>>();
+		sub.runsTasks(); // tasks split off later start deeper, profile puts them at parLevel()+1 too
+		sub.tasks(&tasks);
+		while(sub.await([&]{ return tasks.pop(state); }))
+			sub.run(state);
+		sub.stats.stolen = tasks.stolen();
+	}
+
+	bool reduceCounts(ConceptCounts& counts, vector<pair<int, uint64_t>>& workers){
+		return reduceCountsMPI(counts, workers);
+	}
+public:
+	void run(){ Algorithm::run(); }
+	WorkStealingMPI():tasks_(nullptr), rec_depth_(0){}
+};
@@ -0,0 +1,289 @@
+/*
+bench - end-to-end benchmark driver, a part of JSM toolset.
+
+Generates synthetic contexts in-process (same model as datagen: each object
+has ceil(attributes*density) distinct random attributes) with a seeded generator
+and/or loads FIMI files, then runs each of algorithms with each thread count
+for a number of trials after warmup runs.
+
+Output:
+CSV (or JSON with -json) row per dataset, algorithm and thread count:
+	dataset,algorithm,threads,trials,load_s,median_s,p95_s,peak_rss_kb,concepts,concepts_per_s
+Times are of enumeration alone, concepts are written to a sink that counts them.
+
+Authors: Dmitry Olshansky (c) 2015-
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fca.hpp"
+
+using namespace std;
+
+namespace {
+
+// discards output, counting lines - one per concept
+class CountingSink : public streambuf{
+public:
+	size_t lines = 0;
+protected:
+	int overflow(int c)override{
+		if(c == '\n')
+			lines++;
+		return c;
+	}
+	streamsize xsputn(const char* s, streamsize n)override{
+		lines += count(s, s + n, '\n');
+		return n;
+	}
+};
+
+struct Dataset{
+	string name;
+	string data; // FIMI text
+};
+
+struct Options{
+	vector<string> algorithms = {"fcbo"};
+	vector<size_t> threads = {1};
+	size_t par_level = 2;
+	size_t trials = 5;
+	size_t warmup = 1;
+	size_t min_support = 0;
+	AttributeOrder::Kind order = AttributeOrder::NATURAL;
+	unsigned seed = 1;
+	bool json = false;
+};
+
+struct Result{
+	string dataset, algorithm;
+	size_t threads, trials;
+	double load, median, p95;
+	size_t peak_kb, concepts;
+};
+
+// objects x attributes context, each object with ceil(attributes*density) random attributes
+string generate(size_t objects, size_t attributes, double density, mt19937& rng){
+	size_t cover = min(attributes, (size_t)ceil(attributes * density));
+	vector<size_t> numbers(attributes);
+	iota(numbers.begin(), numbers.end(), 0);
+	ostringstream out;
+	for(size_t o=0; o<objects; o++){
+		for(size_t i=0; i<cover; i++){ // partial Fisher-Yates shuffle picks a random sample
+			uniform_int_distribution<size_t> pick(i, attributes-1);
+			swap(numbers[i], numbers[pick(rng)]);
+		}
+		vector<size_t> row(numbers.begin(), numbers.begin() + cover);
+		sort(row.begin(), row.end());
+		for(size_t i=0; i<row.size(); i++)
+			out << (i ? " " : "") << row[i];
+		out << '\n';
+	}
+	return out.str();
+}
+
+// one run, returns false if algorithm failed to start
+bool trial(const Options& opts, const string& algorithm, size_t threads, const Dataset& set,
+	double& load, double& elapsed, size_t& peak_kb, size_t& concepts){
+	using namespace std::chrono;
+	auto alg = fromName(algorithm);
+	if(!alg)
+		return false;
+	CountingSink sink;
+	ostream out(&sink);
+	resetPeakMemory();
+	alg->verbose(1).threads(threads).parLevel(opts.par_level)
+		.minSupport(opts.min_support).attributeOrder(opts.order);
+	auto beg = high_resolution_clock::now();
+	istringstream in(set.data);
+	if(!alg->loadFIMI(in))
+		return false;
+	auto mid = high_resolution_clock::now();
+	alg->output(out);
+	alg->run();
+	auto end = high_resolution_clock::now();
+	alg.reset(); // flushes the rest of output
+	load = duration<double>(mid - beg).count();
+	elapsed = duration<double>(end - mid).count();
+	peak_kb = peakMemoryKb();
+	concepts = sink.lines;
+	return true;
+}
+
+// nearest-rank percentile of sorted values
+double percentile(const vector<double>& sorted, double p){
+	size_t rank = (size_t)ceil(p * sorted.size());
+	return sorted[rank ? rank - 1 : 0];
+}
+
+bool bench(const Options& opts, const string& algorithm, size_t threads, const Dataset& set, Result& r){
+	double load, elapsed;
+	size_t peak_kb, concepts;
+	for(size_t i=0; i<opts.warmup; i++)
+		if(!trial(opts, algorithm, threads, set, load, elapsed, peak_kb, concepts))
+			return false;
+	vector<double> times, loads;
+	r = Result{set.name, algorithm, threads, opts.trials, 0, 0, 0, 0, 0};
+	for(size_t i=0; i<opts.trials; i++){
+		if(!trial(opts, algorithm, threads, set, load, elapsed, peak_kb, concepts))
+			return false;
+		times.push_back(elapsed);
+		loads.push_back(load);
+		r.peak_kb = max(r.peak_kb, peak_kb);
+		r.concepts = concepts;
+	}
+	sort(times.begin(), times.end());
+	sort(loads.begin(), loads.end());
+	r.load = percentile(loads, 0.5);
+	r.median = percentile(times, 0.5);
+	r.p95 = percentile(times, 0.95);
+	return true;
+}
+
+void printCSV(ostream& os, const Result& r, bool header){
+	if(header)
+		os << "dataset,algorithm,threads,trials,load_s,median_s,p95_s,peak_rss_kb,concepts,concepts_per_s\n";
+	os << r.dataset << ',' << r.algorithm << ',' << r.threads << ',' << r.trials << ','
+		<< r.load << ',' << r.median << ',' << r.p95 << ',' << r.peak_kb << ','
+		<< r.concepts << ',' << (r.median > 0 ? r.concepts / r.median : 0) << '\n';
+}
+
+void printJSON(ostream& os, const Result& r, bool first){
+	os << (first ? "[\n" : ",\n")
+		<< "\t{\"dataset\": \"" << r.dataset << "\", \"algorithm\": \"" << r.algorithm
+		<< "\", \"threads\": " << r.threads << ", \"trials\": " << r.trials
+		<< ", \"load_s\": " << r.load << ", \"median_s\": " << r.median << ", \"p95_s\": " << r.p95
+		<< ", \"peak_rss_kb\": " << r.peak_kb << ", \"concepts\": " << r.concepts
+		<< ", \"concepts_per_s\": " << (r.median > 0 ? r.concepts / r.median : 0) << "}";
+}
+
+// comma separated list of items
+vector<string> split(const char* s){
+	vector<string> items;
+	string item;
+	istringstream in(s);
+	while(getline(in, item, ','))
+		items.push_back(item);
+	return items;
+}
+
+}
+
+int main(int argc, char* argv[]){
+	Options opts;
+	vector<Dataset> sets;
+	vector<string> synthetic; // objects,attributes,density
+	string output;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; i++){
+		switch (argv[i][1]){
+		case 'a':
+			opts.algorithms = split(argv[i] + 2);
+			break;
+		case 't':
+			opts.threads.clear();
+			for(auto& t : split(argv[i] + 2))
+				opts.threads.push_back(atoi(t.c_str()));
+			break;
+		case 'L':
+			opts.par_level = atoi(argv[i] + 2);
+			break;
+		case 'r':
+			opts.trials = max(1, atoi(argv[i] + 2));
+			break;
+		case 'w':
+			opts.warmup = atoi(argv[i] + 2);
+			break;
+		case 'm':
+			opts.min_support = atoi(argv[i] + 2);
+			break;
+		case 's':
+			// -sort same as in gen, -s<seed> of synthetic data
+			if(strcmp(argv[i], "-sort") == 0)
+				opts.order = AttributeOrder::ASCENDING;
+			else
+				opts.seed = atoi(argv[i] + 2);
+			break;
+		case 'o':
+			if(strncmp(argv[i], "-order=", 7) == 0){
+				if(!AttributeOrder::parse(argv[i] + 7, opts.order))
+					goto L_unrecognized;
+			}
+			else
+				output = argv[i] + 2;
+			break;
+		case 'd':
+			// synthetic context: -d<objects>,<attributes>,<density>
+			synthetic.push_back(argv[i] + 2);
+			break;
+		case 'j':
+			if(strcmp(argv[i], "-json") != 0)
+				goto L_unrecognized;
+			opts.json = true;
+			break;
+		default:
+		L_unrecognized:
+			cerr << "Unrecognized option: " << argv[i] << endl;
+			return 1;
+		}
+	}
+	mt19937 rng(opts.seed);
+	for(auto& spec : synthetic){
+		auto parts = split(spec.c_str());
+		if(parts.size() != 3){
+			cerr << "Synthetic data is -d<objects>,<attributes>,<density>, got " << spec << endl;
+			return 1;
+		}
+		sets.push_back({parts[0] + "-" + parts[1] + "-" + parts[2],
+			generate(atoi(parts[0].c_str()), atoi(parts[1].c_str()), atof(parts[2].c_str()), rng)});
+	}
+	for(; i < argc; i++){
+		ifstream in(argv[i]);
+		if(!in){
+			cerr << "Can't open " << argv[i] << endl;
+			return 1;
+		}
+		ostringstream data;
+		data << in.rdbuf();
+		sets.push_back({argv[i], data.str()});
+	}
+	if(sets.empty()){
+		cerr << "Usage ./bench [-a<algorithm>,...] [-t<threads>,...] [-L<par-level>] [-r<trials>] [-w<warmup-runs>]"
+			" [-m<min-support>] [-sort|-order=<order>] [-s<seed>] [-d<objects>,<attributes>,<density>]..."
+			" [-json] [-o<output-file>] [<input-file>...]" << endl;
+		return 1;
+	}
+	ofstream out_file;
+	if(!output.empty())
+		out_file.open(output);
+	ostream& out = output.empty() ? cout : out_file;
+	bool first = true;
+	for(auto& set : sets)
+		for(auto& algorithm : opts.algorithms)
+			for(auto threads : opts.threads){
+				Result r;
+				if(!bench(opts, algorithm, threads, set, r)){
+					cerr << "Failed to run " << algorithm << " on " << set.name << endl;
+					return 1;
+				}
+				if(opts.json)
+					printJSON(out, r, first);
+				else
+					printCSV(out, r, first);
+				out.flush();
+				first = false;
+			}
+	if(opts.json && !first)
+		out << "\n]\n";
+	return 0;
+}
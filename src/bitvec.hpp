@@ -7,6 +7,7 @@
 		- for each attribute call functor
 		- intersect and intersect up to attribute
 		- equal and equal up to attribute
+		- count of items, kept up to date by add/remove, recounted lazily after bulk operations
 */
 
 #pragma once
@@ -16,12 +17,31 @@
 
 inline size_t popcnt(size_t arg)
 {
+#if defined(__GNUC__)
+	return __builtin_popcountll(arg);
+#else
 	size_t bits = 0;
 	while(arg){
 		arg = arg & (arg-1);
 		bits ++;
 	}
 	return bits;
+#endif
+}
+
+// number of trailing zeros, m must not be 0
+inline unsigned ctz(unsigned m)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(m);
+#else
+	unsigned n = 0;
+	while(!(m & 1)){
+		m >>= 1;
+		n++;
+	}
+	return n;
+#endif
 }
 
 template<int tag>
@@ -30,8 +50,10 @@ class BitVec{
 	static size_t length;
 	static size_t words;
 	size_t* data;
+	size_t count_; // cached number of ones, STALE if must be recounted
+	enum : size_t { STALE = ~(size_t)0 };
 	//
-	explicit BitVec(size_t* ptr) : data(ptr){}
+	explicit BitVec(size_t* ptr) : data(ptr), count_(0){}
 
 #if defined(USE_MALLOC_ALLOC)
 	static size_t* alloc(){
@@ -131,16 +153,18 @@ public:
 		setPoolSize();
 	}
 
-	BitVec():data(nullptr){}
+	BitVec():data(nullptr), count_(0){}
 
 	BitVec(BitVec&& v){
 		data = v.data;
+		count_ = v.count_;
 		v.data = nullptr;
 	}
 
 	BitVec& operator=(BitVec&& v){
-		BitVec::~BitVec();
+		dispose(data);
 		data = v.data;
+		count_ = v.count_;
 		v.data = nullptr;
 		return *this;
 	}
@@ -149,20 +173,28 @@ public:
 		return data == nullptr;
 	}
 
+	// bytes of memory held
+	size_t footprint() const {
+		return data ? words*WORD_SIZE : 0;
+	}
+
 	void clearAll(){
 		memset(data, 0, words*WORD_SIZE);
+		count_ = 0;
 	}
 
-	size_t hasMoreThen(size_t items){
-		size_t so_far = 0;
-		for (size_t i = 0; i < words; i++){
-			if(data[i]){
-				so_far += popcnt(data[i]);
-				if(so_far > items)
-					return true;
-			}
+	// number of items, O(1) unless invalidated by merge or intersect
+	size_t count(){
+		if(count_ == STALE){
+			count_ = 0;
+			for (size_t i = 0; i < words; i++)
+				count_ += popcnt(data[i]);
 		}
-		return false;
+		return count_;
+	}
+
+	bool hasMoreThen(size_t items){
+		return count() > items;
 	}
 
 	void setAll(){
@@ -172,7 +204,9 @@ public:
 		}
 		// cut ones for the last word
 		size_t tail = length % BITS;
-		data[words - 1] &= (BIT << tail) - 1;
+		if (tail)
+			data[words - 1] &= (BIT << tail) - 1;
+		count_ = length;
 	}
 
 	// apply to each item, calls functor with integers
@@ -189,9 +223,24 @@ public:
 		}
 	}
 
+	// apply to each item while functor returns true, false if stopped early
+	template<class Fn>
+	bool eachWhile(Fn&& functor){
+		for (size_t i = 0; i < words; i++){
+			if (data[i]){ // skip word at a time if empty
+				for (size_t j = 0, m = 1; j < BITS; j++, m<<= 1){
+					if ((data[i] & m) && !functor(i*BITS + j))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
 	// copy other set over this one
 	void copy(BitVec& vec){
 		memcpy(data, vec.data, words*WORD_SIZE);
+		count_ = vec.count_;
 	}
 
 	// 
@@ -218,12 +267,20 @@ public:
 
 	// set number j
 	BitVec& add(size_t j){
-		data[j / BITS] |= (BIT) << (j & MASK);
+		size_t& w = data[j / BITS];
+		size_t bit = (BIT) << (j & MASK);
+		if (count_ != STALE)
+			count_ += (w & bit) == 0;
+		w |= bit;
 		return *this;
 	}
 
 	BitVec& remove(size_t j){
-		data[j / BITS] &= ~((BIT) << (j & MASK));
+		size_t& w = data[j / BITS];
+		size_t bit = (BIT) << (j & MASK);
+		if (count_ != STALE)
+			count_ -= (w & bit) != 0;
+		w &= ~bit;
 		return *this;
 	}
 
@@ -236,6 +293,7 @@ public:
 		for (size_t i = 0; i < words;i++){
 			data[i] |= vec.data[i];
 		}
+		count_ = STALE;
 		return *this;
 	}
 
@@ -243,6 +301,7 @@ public:
 		for (size_t i = 0; i < words;i++){
 			data[i] &= vec.data[i];
 		}
+		count_ = STALE; // recounted lazily, most intersections (closures of intents) never ask
 		return *this;
 	}
 
@@ -257,6 +316,7 @@ public:
 			size_t mask = (BIT << tail) - 1;
 			data[end] = mask & data[end] & vec.data[end];
 		}
+		count_ = STALE; // words past up_to are left as is
 		return *this;
 	}
 
@@ -9,6 +9,7 @@ class CbO: virtual public Algorithm {
 	using Algorithm::Algorithm;
 	// an interation of Close by One algorithm
 	void impl(ExtSet& A, IntSet& B, size_t y) {
+		Frame frame(*this, B);
 		output(A, B);
 		ExtSet C = ExtSet::newEmpty();
 		IntSet D = IntSet::newFull();
@@ -50,6 +51,7 @@ class GenericBCbO: virtual public HybridAlgorithm {
 	using HybridAlgorithm::HybridAlgorithm;
 	// an interation of Close by One algorithm
 	void impl(ExtSet& A, IntSet& B, size_t y) {
+		Frame frame(*this, B);
 		output(A, B);
 		if(y == attributes())
 			return;
@@ -63,19 +65,19 @@ class GenericBCbO: virtual public HybridAlgorithm {
 					D = IntSet::newFull();
 				}
 				// C empty, D full is a precondition
-				if(closeConcept(A, j, C, D)){ // passed min support test
-					if (B.equal(D, j)){ // equal up to <j
-						q.emplace(move(C), move(D), j);
-						// now C&D are null
-					}
-					else{
-						// reuse existing sets
+				bool passed = closeConcept(A, j, C, D); // passed min support test
+				if(passed && B.equal(D, j)){ // equal up to <j
+					q.emplace(move(C), move(D), j);
+					// now C&D are null
+				}
+				else{
+					if(passed)
 						stats.fail_canon++;
-						C.clearAll();
-						D.setAll();
-					}
+					// reuse existing sets
+					C.clearAll();
+					D.setAll();
 				}
-				
+
 			}
 		}
 		while (!q.empty()){
@@ -116,3 +118,4 @@ using FParCbO = FairForkJoin<GenericBCbO, CbO>;
 using TPCbO = WithThreadPool<GenericBCbO, BCbO>;
 
 using WFCbO = WaveFrontParallel<GenericBCbO>;
+using DWFCbO = WaveFrontDynamic<GenericBCbO>;
@@ -48,7 +48,12 @@ inline unique_ptr<Algorithm> fromName(const string& name){
 		{ "wf-bcbo", &make<WFCbO> },
 		{ "wf-fcbo", &make<WFFCbO> },
 		{ "wf-inclose2", &make<WFInClose2> },
-		{ "wf-inclose3", &make<WFInClose3> }
+		{ "wf-inclose3", &make<WFInClose3> },
+	// wave-front parallel with dynamic claiming of subtrees
+		{ "dwf-bcbo", &make<DWFCbO> },
+		{ "dwf-fcbo", &make<DWFFCbO> },
+		{ "dwf-inclose2", &make<DWFInClose2> },
+		{ "dwf-inclose3", &make<DWFInClose3> }
 	};
 	for(auto& e : table){
 		if(name == e.name)
@@ -14,6 +14,14 @@ using MPI_WFCbO = WaveFrontMPI<GenericBCbO>;
 using MPI_WFFCbO = WaveFrontMPI<GenericFCbO>;
 using MPI_WFInClose2 = WaveFrontMPI<GenericInClose2>;
 using MPI_WFInClose3 = WaveFrontMPI<GenericInClose3>;
+using MPI_DWFCbO = WaveFrontDynamicMPI<GenericBCbO>;
+using MPI_DWFFCbO = WaveFrontDynamicMPI<GenericFCbO>;
+using MPI_DWFInClose2 = WaveFrontDynamicMPI<GenericInClose2>;
+using MPI_DWFInClose3 = WaveFrontDynamicMPI<GenericInClose3>;
+using MPI_WSCbO = WorkStealingMPI<GenericBCbO>;
+using MPI_WSFCbO = WorkStealingMPI<GenericFCbO>;
+using MPI_WSInClose2 = WorkStealingMPI<GenericInClose2>;
+using MPI_WSInClose3 = WorkStealingMPI<GenericInClose3>;
 
 template<class Algo>
 unique_ptr<Algorithm> make(){
@@ -32,7 +40,17 @@ inline unique_ptr<Algorithm> fromName(const string& name){
 		{ "wf-bcbo", &make<MPI_WFCbO> },
 		{ "wf-fcbo", &make<MPI_WFFCbO> },
 		{ "wf-inclose2", &make<MPI_WFInClose2> },
-		{ "wf-inclose3", &make<MPI_WFInClose3> }
+		{ "wf-inclose3", &make<MPI_WFInClose3> },
+	// wave-front MPI with subtrees handed out by rank 0
+		{ "dwf-bcbo", &make<MPI_DWFCbO> },
+		{ "dwf-fcbo", &make<MPI_DWFFCbO> },
+		{ "dwf-inclose2", &make<MPI_DWFInClose2> },
+		{ "dwf-inclose3", &make<MPI_DWFInClose3> },
+	// MPI work stealing
+		{ "ws-bcbo", &make<MPI_WSCbO> },
+		{ "ws-fcbo", &make<MPI_WSFCbO> },
+		{ "ws-inclose2", &make<MPI_WSInClose2> },
+		{ "ws-inclose3", &make<MPI_WSInClose3> }
 	};
 	for(auto& e : table){
 		if(name == e.name)
@@ -8,19 +8,21 @@
 class GenericFCbO : virtual public HybridAlgorithm {
 	using HybridAlgorithm::HybridAlgorithm;
 
-	void impl(ExtSet& A, IntSet& B, size_t y, CompIntSet* N){
+	void impl(ExtSet& A, IntSet& B, size_t y, ImpliedSets* N){
+		Frame frame(*this, B);
 		output(A, B);
 		if (y == attributes())
 			return;
 		queue<Rec> q;
-		CompIntSet* M = N + attributes();
+		ImpliedSets* M = N + 1;
+		M->clear();
+		auto n = N->from(y);
 		ExtSet C;
 		IntSet D;
-		// note that M[0..y] may point to stale sets which however doesn't matter
 		for (size_t j = y; j < attributes(); j++) {
-			M[j] = N[j];
+			IntSet* implied = M->inherit(*N, n, j); // M[j] = N[j]
 			if (!B.has(j)){
-				if (N[j].null() || N[j]->subsetOf(B, j)){ // subset of (considering attributes < j)
+				if (!implied || implied->subsetOf(B, j)){ // subset of (considering attributes < j)
 					// C empty, D full is a precondition
 					toEmpty(C);
 					toFull(D);
@@ -29,7 +31,7 @@ class GenericFCbO : virtual public HybridAlgorithm {
 					}
 					else {
 						stats.fail_canon++;
-						M[j] = move(D); // lose D
+						M->set(j, move(D)); // lose D
 					}
 				}
 				else
@@ -54,12 +56,9 @@ protected:
 		X.each([&](size_t i){
 			Y.intersect(row(i));
 		});
-		// intents with implied error, see FCbO papper
-		CompIntSet* implied = new CompIntSet[(attributes()+1)*attributes()];  //TODO: overkill for parallel versions..
-		impl(X, Y, 0, implied);
-		// may avoid freeing this in one-shot program
-		// can't do this in parallel version, as this is only the first step
-		// delete[] implied;
+		// intents with implied error, see FCbO papper; scheduled tasks share the sets they need
+		vector<ImpliedSets> implied(attributes()+1);
+		impl(X, Y, 0, implied.data());
 	}
 public:
 	void run(ExtendedState& state){
@@ -76,3 +75,4 @@ using FParFCbO = FairForkJoin<GenericFCbO, FCbO>;
 using TPFCbO = WithThreadPool<GenericFCbO, FCbO>;
 
 using WFFCbO = WaveFrontParallel<GenericFCbO>;
+using DWFFCbO = WaveFrontDynamic<GenericFCbO>;
@@ -51,7 +51,23 @@ int entry(int argc, char* argv[]){
 	size_t verbose = 1;
 	size_t min_support = 0;
 	size_t buf_size = 32; // no worries, going to adaptively resize anyway
-	bool sorted = false;
+	size_t top_k = 0;
+	size_t queue_mb = 0;
+	TopK::Rank rank = TopK::SUPPORT;
+	AttributeOrder::Kind attribute_order = AttributeOrder::NATURAL;
+	string checkpoint_file;
+	string stats_file;
+	string profile_file;
+	double progress = 0;
+	bool count = false;
+	bool binary = false;
+	Algorithm::OutputMode output_mode = Algorithm::INTENTS;
+	double checkpoint_period = 600;
+	bool resume = false;
+	bool numa = false;
+	bool reduce = false;
+	bool merge = false;
+	Algorithm::ObjectOrder object_order = Algorithm::INPUT;
 	int i = 1;
 	for (; i < argc && argv[i][0] == '-'; i++){
 		switch (argv[i][1]){
@@ -64,17 +80,104 @@ int entry(int argc, char* argv[]){
 			}
 			break;
 		case 'b':
+			// binary records of concepts instead of text
+			if(strcmp(argv[i], "-binary") == 0){
+				binary = true;
+				break;
+			}
 			buf_size = atoi(argv[i] + 2);
 			break;
 		case 's':
+			// stats of all threads as JSON: -stats=<file>
+			if(strncmp(argv[i], "-stats=", 7) == 0){
+				stats_file = string(argv[i] + 7);
+				break;
+			}
+			// support of each concept after its intent, same as -output=support
+			if(strcmp(argv[i], "-support") == 0){
+				output_mode = Algorithm::SUPPORTS;
+				break;
+			}
 			if(strcmp(argv[i], "-sort") != 0)
 				goto L_unrecognized;
-			sorted = true;
+			attribute_order = AttributeOrder::ASCENDING;
+			break;
+		case 'o':
+			// order of attributes: -order=natural|asc|desc|cooc|cost|auto
+			if(strncmp(argv[i], "-order=", 7) == 0){
+				if(!AttributeOrder::parse(argv[i] + 7, attribute_order))
+					goto L_unrecognized;
+			}
+			// order of objects: -object-order=input|lex|gray
+			else if(strcmp(argv[i], "-object-order=input") == 0)
+				object_order = Algorithm::INPUT;
+			else if(strcmp(argv[i], "-object-order=lex") == 0)
+				object_order = Algorithm::LEX;
+			else if(strcmp(argv[i], "-object-order=gray") == 0)
+				object_order = Algorithm::GRAY;
+			// what to print of concepts: -output=intent|support|concept|extent
+			else if(strcmp(argv[i], "-output=intent") == 0)
+				output_mode = Algorithm::INTENTS;
+			else if(strcmp(argv[i], "-output=support") == 0)
+				output_mode = Algorithm::SUPPORTS;
+			else if(strcmp(argv[i], "-output=concept") == 0)
+				output_mode = Algorithm::CONCEPTS;
+			else if(strcmp(argv[i], "-output=extent") == 0)
+				output_mode = Algorithm::EXTENTS;
+			else
+				goto L_unrecognized;
 			break;
 		case 'm':
+			// merge identical objects into weighted ones
+			if(strcmp(argv[i], "-merge") == 0){
+				merge = true;
+				break;
+			}
 			// minimal support
 			min_support = atoi(argv[i] + 2);
 			break;
+		case 'n':
+			// pin threads and replicate context per NUMA node
+			if(strcmp(argv[i], "-numa") != 0)
+				goto L_unrecognized;
+			numa = true;
+			break;
+		case 'M':
+			// memory budget for queued tasks, megabytes
+			queue_mb = atoi(argv[i] + 2);
+			break;
+		case 'k':
+			// only k best concepts
+			top_k = atoi(argv[i] + 2);
+			break;
+		case 'r':
+			if(strcmp(argv[i], "-rank=support") == 0)
+				rank = TopK::SUPPORT;
+			else if(strcmp(argv[i], "-rank=area") == 0)
+				rank = TopK::AREA;
+			else if(strcmp(argv[i], "-resume") == 0)
+				resume = true;
+			// drop redundant attributes and merge identical objects
+			else if(strcmp(argv[i], "-reduce") == 0)
+				reduce = merge = true;
+			else
+				goto L_unrecognized;
+			break;
+		case 'c':
+			// only count concepts, JSON with histograms goes to output
+			if(strcmp(argv[i], "-count") == 0){
+				count = true;
+				break;
+			}
+			// checkpoint file and optionally period in seconds: -checkpoint=<file>[,<seconds>]
+			if(strncmp(argv[i], "-checkpoint=", 12) != 0)
+				goto L_unrecognized;
+			checkpoint_file = string(argv[i] + 12);
+			if(checkpoint_file.find(',') != string::npos){
+				checkpoint_period = atof(checkpoint_file.c_str() + checkpoint_file.find(',') + 1);
+				checkpoint_file.resize(checkpoint_file.find(','));
+			}
+			break;
 		case 'v':
 			verbose = atoi(argv[i] + 2);
 			break;
@@ -84,6 +187,19 @@ int entry(int argc, char* argv[]){
 		case 'L':
 			par_level = atoi(argv[i] + 2);
 			break;
+		case 'p':
+			// profile of enumeration tree by depth and subtree, folded stacks: -profile=<file>
+			if(strncmp(argv[i], "-profile=", 9) == 0)
+				profile_file = string(argv[i] + 9);
+			// report progress every so many seconds: -progress=<seconds>
+			else if(strncmp(argv[i], "-progress=", 10) == 0)
+				progress = atof(argv[i] + 10);
+			// hardware counters per phase and thread, see main
+			else if(strcmp(argv[i], "-perf") == 0)
+				PerfCounters::enabled() = true;
+			else
+				goto L_unrecognized;
+			break;
 		default:
 		L_unrecognized:
 			cerr << "Unrecognized option: " << argv[i] << endl;
@@ -94,7 +210,11 @@ int entry(int argc, char* argv[]){
 	argc = argc - i;
 	if (!alg){
 		cerr << "Algorithm not specified" << endl;
-		cerr << "Usage ./gen -a<algorithm> [-sort] [-b<io_buf_size_in_bytes>] [-v<verbosity>] [-L<par-level>] [-t<num-threads>]" << endl;
+		cerr << "Usage ./gen -a<algorithm> [-sort] [-b<io_buf_size_in_bytes>] [-v<verbosity>] [-L<par-level>] [-t<num-threads>]"
+			" [-m<min-support>] [-k<top-k> [-rank=support|area]] [-M<queue-memory-mb>] [-numa] [-reduce] [-merge]"
+			" [-stats=<file>] [-profile=<file>] [-progress=<seconds>] [-perf] [-count] [-support] [-output=intent|support|concept|extent] [-binary]"
+			" [-order=natural|asc|desc|cooc|cost|auto] [-object-order=input|lex|gray]"
+			" [-checkpoint=<file>[,<seconds>] [-resume]] [<input-file> [<output-file>]]" << endl;
 		return 1;
 	}
 	if (verbose > 1){
@@ -103,7 +223,11 @@ int entry(int argc, char* argv[]){
 	}
 	alg->verbose(verbose).threads(num_threads)
 		.parLevel(par_level).minSupport(min_support)
-		.bufferSize(buf_size).sortAttrs(sorted);
+		.bufferSize(buf_size).attributeOrder(attribute_order).objectOrder(object_order)
+		.queueBudget(queue_mb << 20).numa(numa)
+		.reduce(reduce).mergeObjects(merge).statsFile(stats_file)
+		.profileFile(profile_file).progress(progress).countConcepts(count)
+		.outputMode(output_mode).binaryOutput(binary);
 	if (argc > 0){
 		in_file.open(argv[0]);
 		if (!alg->loadFIMI(in_file)){
@@ -118,8 +242,27 @@ int entry(int argc, char* argv[]){
 	if( verbose > 1){
 		cerr << "Total attributes: " << alg->attributes() << endl;
 	}
+	if (top_k){
+		alg->topK(top_k, rank);
+	}
+	if (!checkpoint_file.empty()){
+		if (argc < 2 || top_k || !alg->resumable()){
+			cerr << "Checkpoints need output file, can't go with top-k and are supported"
+				" only by serial and tp-* algorithms other than cbo" << endl;
+			return 1;
+		}
+		alg->checkpoint(checkpoint_file, argv[1], checkpoint_period, resume);
+	}
 	if (argc > 1){
-		out_file.open(argv[1]);
+		if (resume && !checkpoint_file.empty()){
+			// drop output written past the checkpoint and continue from there
+			truncateFile(argv[1], checkpointedOutput(checkpoint_file));
+			out_file.open(argv[1], ios::in | ios::out | ios::ate);
+			if (!out_file.is_open())
+				out_file.open(argv[1]);
+		}
+		else
+			out_file.open(argv[1]);
 		alg->output(out_file);
 	}
 	alg->run(); 
@@ -132,6 +275,10 @@ int entry(int argc, char* argv[]){
 
 int main(int argc, char* argv[]){
 	int code = 1;
+	// total is measured from the start, before options are parsed
+	for(int i = 1; i < argc && argv[i][0] == '-'; i++)
+		if(strcmp(argv[i], "-perf") == 0)
+			PerfCounters::enabled() = true;
 	measure([&](){  code = entry(argc, argv); }, "Time", true); // always print run-time
 	return code;
 }
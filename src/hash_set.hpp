@@ -1,12 +1,166 @@
+/**
+	Hash table implementation of integer set concept.
+	Flat open addressing: keys are stored in one array of slots
+	with a parallel array of 1-byte control tags, probing is linear
+	over groups of 16 slots. A control byte is either EMPTY, DELETED or
+	7 bits of the key's hash, so a lookup compares all 16 tags of a group
+	at once (SSE2) and touches the key array only on tag match.
+
+	Iteration order is unspecified, has/add/remove are O(1),
+	cardinality is tracked so hasMoreThen is O(1) as well.
+*/
 #pragma once
-#include <unordered_set>
 
+#if defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+	#define HASH_SET_SSE2
+#endif
+
+template<int tag>
 class HashSet{
+	enum { GROUP = 16 };
+	enum : signed char { EMPTY = -128, DELETED = -2 }; // occupied slots have tag >= 0
 	static size_t total;
-	unordered_set<unsigned> attrs;
+	vector<signed char> ctrl;
+	vector<unsigned> keys;
+	size_t size_; // number of keys
+	size_t used_; // keys + tombstones
 	bool full; // == true - means all ones (to avoid allocating the whole hash table)
+
+	static size_t hash(size_t v){
+		size_t h = v * (size_t)0x9E3779B97F4A7C15ULL;
+		return h ^ (h >> 29);
+	}
+	static signed char tagOf(size_t h){ return (signed char)(h & 0x7F); }
+
+	// bit mask of positions in the group with control byte equal to c
+	static unsigned match(const signed char* group, signed char c){
+#ifdef HASH_SET_SSE2
+		__m128i g = _mm_loadu_si128((const __m128i*)group);
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+#else
+		unsigned mask = 0;
+		for(unsigned i=0; i<GROUP; i++)
+			if(group[i] == c)
+				mask |= 1u<<i;
+		return mask;
+#endif
+	}
+
+	size_t groups()const{ return ctrl.size() / GROUP; }
+
+	// slot of the key or npos
+	size_t find(size_t v)const{
+		if(!size_)
+			return npos();
+		size_t h = hash(v);
+		signed char t = tagOf(h);
+		size_t gmask = groups() - 1;
+		for(size_t g = (h >> 7) & gmask;; g = (g + 1) & gmask){
+			const signed char* grp = &ctrl[g*GROUP];
+			for(unsigned m = match(grp, t); m; m &= m-1){
+				size_t slot = g*GROUP + ctz(m);
+				if(keys[slot] == v)
+					return slot;
+			}
+			if(match(grp, EMPTY)) // key would have been placed here
+				return npos();
+		}
+	}
+
+	// place key known to be absent
+	void insert(size_t v){
+		if((used_ + 1) * 8 > ctrl.size() * 7) // keep load under 7/8
+			rehash(size_ * 2 >= ctrl.size() ? ctrl.size()*2 : ctrl.size());
+		size_t h = hash(v);
+		size_t gmask = groups() - 1;
+		for(size_t g = (h >> 7) & gmask;; g = (g + 1) & gmask){
+			signed char* grp = &ctrl[g*GROUP];
+			unsigned m = match(grp, EMPTY) | match(grp, DELETED);
+			if(m){
+				size_t slot = g*GROUP + ctz(m);
+				if(ctrl[slot] == EMPTY)
+					used_++;
+				ctrl[slot] = tagOf(h);
+				keys[slot] = (unsigned)v;
+				size_++;
+				return;
+			}
+		}
+	}
+
+	// rebuild table of given capacity dropping tombstones
+	void rehash(size_t capacity){
+		if(capacity < GROUP)
+			capacity = GROUP;
+		vector<signed char> old_ctrl(capacity, EMPTY);
+		vector<unsigned> old_keys(capacity);
+		old_ctrl.swap(ctrl);
+		old_keys.swap(keys);
+		size_ = used_ = 0;
+		for(size_t i=0; i<old_ctrl.size(); i++)
+			if(old_ctrl[i] >= 0)
+				insert(old_keys[i]);
+	}
+
+	void erase(size_t slot){
+		ctrl[slot] = DELETED;
+		size_--;
+	}
+
+	// number of keys < up_to
+	size_t countUpTo(size_t up_to)const{
+		if(up_to >= total)
+			return size_;
+		size_t cnt = 0;
+		for(size_t i=0; i<ctrl.size(); i++)
+			if(ctrl[i] >= 0 && keys[i] < up_to)
+				cnt++;
+		return cnt;
+	}
+
+	// keys are distinct - must be each integer in the range
+	bool hasAllUpTo(size_t up_to)const{
+		return countUpTo(up_to) == up_to;
+	}
+
+	// all keys < up_to are also in set
+	bool includedIn(const HashSet& set, size_t up_to)const{
+		for(size_t i=0; i<ctrl.size(); i++)
+			if(ctrl[i] >= 0 && keys[i] < up_to && set.find(keys[i]) == npos())
+				return false;
+		return true;
+	}
+
+	// turn "full" flag into explicit keys
+	void materialize(){
+		full = false;
+		clearAll();
+		for(size_t i=0; i<total; i++)
+			insert(i);
+	}
+
+	static size_t npos(){ return ~(size_t)0; }
 public:
-	explicit HashSet(bool full_=false):full(full_){}
+	explicit HashSet(bool full_=false):size_(0), used_(0), full(full_){}
+
+	// moved-from set is left null, same as with BitVec
+	HashSet(HashSet&& set){
+		*this = move(set);
+	}
+
+	HashSet& operator=(HashSet&& set){
+		ctrl = move(set.ctrl);
+		keys = move(set.keys);
+		size_ = set.size_;
+		used_ = set.used_;
+		full = set.full;
+		set.ctrl.clear();
+		set.keys.clear();
+		set.size_ = set.used_ = 0;
+		set.full = false;
+		return *this;
+	}
 	static HashSet* newArray(size_t n){
 		HashSet* ptrs = new HashSet[n];
 		return ptrs;
@@ -18,7 +172,7 @@ public:
 		return HashSet(false);
 	}
 	static HashSet newFull(){
-		return HashSet(true);	
+		return HashSet(true);
 	}
 
 	template<class Fn>
@@ -28,75 +182,91 @@ public:
 				fn(i);
 		}
 		else
-			for_each(attrs.begin(), attrs.end(), fn);
+			for(size_t i=0; i<ctrl.size(); i++)
+				if(ctrl[i] >= 0)
+					fn(keys[i]);
+	}
+
+	// apply to each item while fn returns true, false if stopped early
+	template<class Fn>
+	bool eachWhile(Fn&& fn){
+		if(full){
+			for(unsigned i=0; i<total; i++)
+				if(!fn(i))
+					return false;
+			return true;
+		}
+		for(size_t i=0; i<ctrl.size(); i++)
+			if(ctrl[i] >= 0 && !fn(keys[i]))
+				return false;
+		return true;
 	}
-	
+
 	void clearAll(){
 		full = false;
-		attrs.clear();
+		fill(ctrl.begin(), ctrl.end(), EMPTY);
+		size_ = used_ = 0;
 	}
 
 	void setAll(){
+		clearAll();
 		full = true;
-		attrs.clear();
 	}
 
 	bool has(size_t val){
-		if(full)
-			return true;
-		if(attrs.size() == 0)
-			return false;
-		if(val < attrs.front())
-			return false;
-		if(val > attrs.back())
-			return false;
-		return binary_search(attrs.begin(), attrs.end(), val);
+		return full || find(val) != npos();
 	}
 
 	bool null(){
-		return !full && attrs.size() == 0;
+		return !full && size_ == 0;
+	}
+
+	// bytes of memory held
+	size_t footprint() const {
+		return ctrl.capacity() + keys.capacity()*sizeof(unsigned);
+	}
+
+	// number of items, O(1)
+	size_t count(){
+		return full ? total : size_;
 	}
 
 	bool hasMoreThen(size_t items){
-		return full || attrs.size() > items;
+		return count() > items;
 	}
 
-	void add(size_t val){
+	HashSet& add(size_t val){
+		if(!full && find(val) == npos())
+			insert(val);
+		return *this;
+	}
+
+	HashSet& remove(size_t val){
 		if(full)
-			return;
-		if(attrs.size() && attrs.back() < val){ // 100% of uses for extents in *CbO and *InClose2/3
-			attrs.push_back(val);
-		}
-		else {
-			auto it = lower_bound(attrs.begin(), attrs.end(), val);
-			attrs.insert(it, val);
-		}
+			materialize();
+		size_t slot = find(val);
+		if(slot != npos())
+			erase(slot);
+		return *this;
 	}
 
 	void copy(HashSet& set){
-		if(set.full){
-			full = true;
-			attrs.clear();
-		}
-		else{
-			full = false;
-			attrs.resize(set.attrs.size());
-			std::copy(set.attrs.begin(), set.attrs.end(), attrs.begin());
-		}
+		full = set.full;
+		ctrl = set.ctrl;
+		keys = set.keys;
+		size_ = set.size_;
+		used_ = set.used_;
 	}
 
-	// 
+	//
 	bool equal(HashSet& set, size_t up_to){
-		if(full ^ set.full)
-			return false;
-		// here we got both full or both not full
-		if(full)
+		if(full && set.full)
 			return true;
-		auto tend = lower_bound(attrs.begin(), attrs.end(), up_to);
-		auto set_end = lower_bound(set.attrs.begin(), set.attrs.end(), up_to);
-		if(tend - attrs.begin() != set_end - set.attrs.begin())
-			return false;
-		return std::equal(attrs.begin(), tend, set.attrs.begin());
+		if(set.full)
+			return hasAllUpTo(up_to);
+		if(full)
+			return set.hasAllUpTo(up_to);
+		return countUpTo(up_to) == set.countUpTo(up_to) && includedIn(set, up_to);
 	}
 
 	//
@@ -104,25 +274,11 @@ public:
 		if(full ^ set.full)
 			return false;
 		// here we got both full or both not full
-		return full || attrs == set.attrs;
+		return full || (size_ == set.size_ && includedIn(set, total));
 	}
 
 	HashSet& intersect(HashSet& set){
-		if(set.full){
-			return *this;
-		}
-		if(full){ // full but the other one isn't
-			attrs = set.attrs;
-			full = false;
-			return *this;
-		}
-		// both are not full - need to compute intersection
-		vector<unsigned> inter;
-		set_intersection(attrs.begin(), attrs.end(),
-			set.attrs.begin(), set.attrs.end(), 
-			std::back_inserter(inter));
-		attrs = inter;
-		return *this;
+		return intersect(set, total);
 	}
 
 	// intersect up to given attribute
@@ -131,37 +287,25 @@ public:
 			return *this;
 		}
 		if(full){ // full but the other one isn't
-			attrs = set.attrs;
-			full = false;
+			copy(set);
+			if(up_to < total)
+				for(size_t i=0; i<ctrl.size(); i++)
+					if(ctrl[i] >= 0 && keys[i] >= up_to)
+						erase(i);
 			return *this;
 		}
-		// both are not full - need to compute intersection 
-		vector<unsigned> inter;
-		// minding the up_to
-		auto tset = lower_bound(set.attrs.begin(), set.attrs.end(), up_to);
-		set_intersection(attrs.begin(), attrs.end(),
-			set.attrs.begin(), tset, 
-			std::back_inserter(inter));
-		attrs = inter;
+		// drop what is not in the other set, tombstones are swept by clearAll or rehash
+		for(size_t i=0; i<ctrl.size(); i++)
+			if(ctrl[i] >= 0 && (keys[i] >= up_to || set.find(keys[i]) == npos()))
+				erase(i);
 		return *this;
 	}
 
 	bool subsetOf(HashSet& set, size_t up_to){
-		if(full){
-			if(set.full)
-				return true;
-			auto set_end = lower_bound(set.attrs.begin(), set.attrs.end(), up_to);
-			return set_end - set.attrs.begin() == up_to; // must have all up_to of elements
-		}
-		if(set.full){ // same but reverse - now our set must have all of elements
-			auto tend = lower_bound(attrs.begin(), attrs.end(), up_to);
-			return tend - attrs.begin() == up_to; // must have all up_to of elements
-		}
-		auto tend = lower_bound(attrs.begin(), attrs.end(), up_to);
-		auto set_end = lower_bound(set.attrs.begin(), set.attrs.end(), up_to);
-		if(tend - attrs.begin() != set_end - set.attrs.begin()) // different size of ranges
-			return false;
-		// got to compare
-		return std::equal(attrs.begin(), tend, set.attrs.begin());
+		if(set.full)
+			return true;
+		if(full)
+			return set.hasAllUpTo(up_to);
+		return includedIn(set, up_to);
 	}
 };
@@ -9,6 +9,7 @@ class GenericInClose2 : virtual public HybridAlgorithm {
 	using HybridAlgorithm::HybridAlgorithm;
 
 	void impl(ExtSet& A, IntSet& B, size_t y){
+		Frame frame(*this, B);
 		if (y == attributes()){
 			output(A, B);
 			return;
@@ -22,7 +23,7 @@ class GenericInClose2 : virtual public HybridAlgorithm {
 				if (filterExtent(A, j, C)){ // if A == C
 					B.add(j);
 				}
-				else{
+				else if(supported(C)){ // passed min support test
 					toFull(D);
 					partialClosure(C, j, D);
 					if (B.equal(D, j)){ // equal up to <j
@@ -67,3 +68,4 @@ using FParInClose2 = FairForkJoin<GenericInClose2, InClose2>;
 using TPInClose2 = WithThreadPool<GenericInClose2, InClose2>;
 
 using WFInClose2 = WaveFrontParallel<GenericInClose2>;
+using DWFInClose2 = WaveFrontDynamic<GenericInClose2>;
@@ -9,7 +9,8 @@
 class GenericInClose3: virtual public HybridAlgorithm {
 	using HybridAlgorithm::HybridAlgorithm;
 
-	void impl(ExtSet& A, IntSet& B, size_t y, CompIntSet* N){
+	void impl(ExtSet& A, IntSet& B, size_t y, ImpliedSets* N){
+		Frame frame(*this, B);
 		if (y == attributes()){
 			output(A, B);
 			return;
@@ -17,26 +18,33 @@ class GenericInClose3: virtual public HybridAlgorithm {
 		queue<Rec> q;
 		ExtSet C;
 		IntSet D;
-		CompIntSet* M = N + attributes();
+		ImpliedSets* M = N + 1;
+		M->clear();
+		auto n = N->from(y);
 		for (size_t j = y; j < attributes(); j++) {
-			M[j] = N[j];
+			IntSet* implied = M->inherit(*N, n, j); // M[j] = N[j]
 			if (!B.has(j)){
-				if (N[j].null() || N[j]->subsetOf(B, j)){ // subset of (considering attributes < j)
+				if (!implied || implied->subsetOf(B, j)){ // subset of (considering attributes < j)
 					toEmpty(C);
 					if (filterExtent(A, j, C)){ // if A == C
 						B.add(j);
 					}
-					else{
+					else if(supported(C)){ // passed min support test
 						toFull(D);
 						partialClosure(C, j, D);
 						if (B.equal(D, j)){ // equal up to <j
 							q.emplace(move(C), move(D), j);
 						}
 						else {
-							M[j] = move(D);
+							M->set(j, move(D));
 							stats.fail_canon++;
 						}
 					}
+					else{
+						// extents below are subsets of A, so j can't reach min support there either;
+						// full set as implied intent makes the fast test drop j in the subtree
+						M->set(j, IntSet::newFull());
+					}
 				}
 				else
 					stats.fail_fast++;
@@ -57,13 +65,11 @@ public:
 	virtual void processQueueItem(State&&)=0;
 protected:
 	void algorithm(){
-		// intents with implied error, see FCbO papper
-		CompIntSet* implied = new CompIntSet[(attributes()+1)*attributes()]; //overkill for parallel versions..
+		// intents with implied error, see FCbO papper; scheduled tasks share the sets they need
+		vector<ImpliedSets> implied(attributes()+1);
 		ExtSet X = ExtSet::newFull();
 		IntSet Y = IntSet::newEmpty();
-		impl(X, Y, 0, implied);
-		// can't delete here because of parellel version that follows up using these sets
-		// delete[] implied;
+		impl(X, Y, 0, implied.data());
 	}
 public:
 	void run(ExtendedState& state){
@@ -82,3 +88,4 @@ using FParInClose3 = FairForkJoin<GenericInClose3, InClose3>;
 using TPInClose3 = WithThreadPool<GenericInClose3, InClose3>;
 
 using WFInClose3 = WaveFrontParallel<GenericInClose3>;
+using DWFInClose3 = WaveFrontDynamic<GenericInClose3>;
@@ -37,7 +37,7 @@ using namespace std;
 void usage(){
 	cerr << "Usage ./jsm -a<algorithm> -m<min-support> -s<attributes> -p<props> "
 		"-i+<plus-file> -i-<minus-file> -o<hyp-file> [-f{direct|no-counter}] [-v<verbosity>] [-L<par-level>]"
-		"[-t<num-threads>]\n";
+		"[-t<num-threads>] [-progress=<seconds>]\n";
 	exit(1);
 }
 
@@ -70,6 +70,7 @@ int main(int argc, char* argv[])
 	size_t attributes = 0;
 	size_t props = 0;
 	bool direct = true;
+	double progress = 0;
 	int i = 1;
 	for (; i < argc && argv[i][0] == '-'; i++){
 		switch (argv[i][1]){
@@ -87,7 +88,11 @@ int main(int argc, char* argv[])
 			attributes = atoi(argv[i] + 2);
 			break;
 		case 'p':
-			props = atoi(argv[i] + 2);
+			// report progress every so many seconds: -progress=<seconds>
+			if(strncmp(argv[i], "-progress=", 10) == 0)
+				progress = atof(argv[i] + 10);
+			else
+				props = atoi(argv[i] + 2);
 			break;
 		case 'm':
 			// minimal support
@@ -158,7 +163,7 @@ int main(int argc, char* argv[])
 	chrono::duration<double> elapsed;
 	{
 		alg->verbose(verbose).threads(num_threads)
-			.parLevel(par_level).minSupport(min_support);
+			.parLevel(par_level).minSupport(min_support).progress(progress);
 		ifstream plus_stream(plus_in.c_str());
 		ifstream minus_stream(minus_in.c_str());
 		ofstream hyp_stream(hyp_out.c_str());
@@ -2,6 +2,7 @@
 
 #include "misc.hpp" // myEqual
 
+template<int tag>
 class LinearSet{
 	static size_t total;
 	vector<unsigned> attrs;
@@ -40,6 +41,21 @@ public:
 			for_each(attrs.begin(), attrs.end(), fn);
 	}
 	
+	// apply to each item while fn returns true, false if stopped early
+	template<class Fn>
+	bool eachWhile(Fn&& fn){
+		if(full){
+			for(unsigned i=0; i<total; i++)
+				if(!fn(i))
+					return false;
+			return true;
+		}
+		for(auto v : attrs)
+			if(!fn(v))
+				return false;
+		return true;
+	}
+
 	void clearAll(){
 		full = false;
 		attrs.clear();
@@ -66,8 +82,18 @@ public:
 		return !full && attrs.size() == 0;
 	}
 
+	// bytes of memory held
+	size_t footprint() const {
+		return attrs.capacity()*sizeof(unsigned);
+	}
+
+	// number of items, O(1)
+	size_t count(){
+		return full ? total : attrs.size();
+	}
+
 	bool hasMoreThen(size_t items){
-		return full || attrs.size() > items;
+		return count() > items;
 	}
 
 	void add(size_t val){
@@ -158,21 +184,12 @@ public:
 	}
 
 	bool subsetOf(LinearSet& set, size_t up_to){
-		if(full){
-			if(set.full)
-				return true;
-			auto set_end = lower_bound(set.attrs.begin(), set.attrs.end(), up_to);
-			return set_end - set.attrs.begin() == up_to; // must have all up_to of elements
-		}
-		if(set.full){ // same but reverse - now our set must have all of elements
-			auto tend = lower_bound(attrs.begin(), attrs.end(), up_to);
-			return tend - attrs.begin() == up_to; // must have all up_to of elements
-		}
+		if(set.full)
+			return true;
+		if(full)
+			return set.hasAllUpTo(up_to);
 		auto tend = lower_bound(attrs.begin(), attrs.end(), up_to);
 		auto set_end = lower_bound(set.attrs.begin(), set.attrs.end(), up_to);
-		if(tend - attrs.begin() != set_end - set.attrs.begin()) // different size of ranges
-			return false;
-		// got to compare
-		return myEqual(attrs.begin(), tend, set.attrs.begin(), set_end);
+		return includes(set.attrs.begin(), set_end, attrs.begin(), tend);
 	}
 };
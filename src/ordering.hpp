@@ -0,0 +1,281 @@
+/**
+	Heuristic orders of attributes. Order doesn't change the set of concepts,
+	but it does change the shape of the search tree: how large a part of the context
+	each branch works with and how often canonicity tests fail.
+
+	Order is given as positions -> original attribute numbers, the same way
+	as Algorithm keeps it, so output stays in original numbering.
+
+	Estimates are done on a random sample of objects (fixed seed, so
+	runs are reproducible) with a tiny CbO over bit columns of the sample.
+*/
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class AttributeOrder{
+public:
+	enum Kind{
+		NATURAL, // as numbered in input
+		ASCENDING, // by support, least frequent first
+		DESCENDING, // by support, most frequent first
+		COOCCURRENCE, // chains of attributes that often go together, starting from rare ones
+		COST, // by estimated size of the subtree containing the attribute, cheapest first
+		AUTO // best of the above on a probe run
+	};
+private:
+	enum : size_t {
+		COOC_SAMPLE = 1024, // objects to estimate co-occurrence on
+		COOC_LIMIT = 4096, // more attributes than that - too costly, fall back to ASCENDING
+		PROBE_SAMPLE = 128, // objects of probe runs
+		PROBE_WORK = 1<<24 // word operations per probing pass
+	};
+	using Column = vector<uint64_t>;
+
+	const vector<vector<int>>& values_; // objects as lists of attributes
+	size_t attributes_;
+	const vector<size_t>& supps_;
+	size_t min_support_;
+	vector<size_t> sample_; // objects in random order
+
+	// Tiny CbO over columns of sampled objects, counts closures and concepts
+	struct Probe{
+		vector<Column> cols; // in probed order
+		Column objects; // all of the sample
+		size_t words, min_count, budget, closures, concepts;
+
+		Probe(vector<Column> columns, Column all, size_t min_count_, size_t budget_):
+			cols(move(columns)), objects(move(all)), words(objects.size()), min_count(min_count_),
+			budget(budget_), closures(0), concepts(0){}
+
+		size_t count(const Column& ext)const{
+			size_t n = 0;
+			for(auto w : ext)
+				n += bitset<64>(w).count();
+			return n;
+		}
+
+		bool contains(const Column& col, const Column& ext)const{
+			for(size_t w=0; w<words; w++)
+				if(ext[w] & ~col[w])
+					return false;
+			return true;
+		}
+
+		// positions of attributes common to all of the extent
+		void close(const Column& ext, vector<char>& intent)const{
+			for(size_t p=0; p<cols.size(); p++)
+				intent[p] = contains(cols[p], ext);
+		}
+
+		void cbo(const Column& A, const vector<char>& B, size_t y){
+			concepts++;
+			Column C(words);
+			vector<char> D(cols.size());
+			for(size_t j=y; j<cols.size() && closures < budget; j++){
+				if(B[j])
+					continue;
+				for(size_t w=0; w<words; w++)
+					C[w] = A[w] & cols[j][w];
+				closures++;
+				if(min_count && count(C) < min_count)
+					continue;
+				close(C, D);
+				if(equal(D.begin(), D.begin() + j, B.begin())) // canonical
+					cbo(C, D, j+1);
+			}
+		}
+
+		// concepts of the whole sample
+		void all(){
+			vector<char> B(cols.size());
+			close(objects, B);
+			cbo(objects, B, 0);
+		}
+
+		// concepts having the first attribute, that is its subtree with the attribute placed first
+		void first(){
+			Column A = cols[0];
+			vector<char> B(cols.size());
+			closures++;
+			if(min_count && count(A) < min_count)
+				return;
+			close(A, B);
+			cbo(A, B, 1);
+		}
+	};
+
+	// bit columns of the first n sampled objects for attributes in order
+	vector<Column> columns(const vector<size_t>& order, size_t n)const{
+		n = min(n, sample_.size());
+		size_t words = (n + 63) / 64;
+		vector<size_t> pos(attributes_);
+		for(size_t p=0; p<order.size(); p++)
+			pos[order[p]] = p;
+		vector<Column> cols(order.size(), Column(words));
+		for(size_t i=0; i<n; i++){
+			for(auto a : values_[sample_[i]])
+				cols[pos[a]][i/64] |= (uint64_t)1 << (i%64);
+		}
+		return cols;
+	}
+
+	// minimal support scaled down to the first n sampled objects
+	size_t minCount(size_t n)const{
+		n = min(n, sample_.size());
+		return sample_.empty() ? 0 : min_support_ * n / sample_.size();
+	}
+
+	// bit column of the first n sampled objects
+	Column objects(size_t n)const{
+		n = min(n, sample_.size());
+		Column all((n + 63) / 64, ~(uint64_t)0);
+		if(n % 64)
+			all.back() >>= 64 - n%64;
+		return all;
+	}
+
+	vector<size_t> bySupport(bool ascending)const{
+		vector<size_t> order(attributes_);
+		iota(order.begin(), order.end(), 0);
+		stable_sort(order.begin(), order.end(), [&](size_t i, size_t j){
+			return ascending ? supps_[i] < supps_[j] : supps_[i] > supps_[j];
+		});
+		return order;
+	}
+
+	// greedy chain: next is the attribute most similar (Jaccard index on sample) to the last one
+	vector<size_t> byCooccurrence()const{
+		vector<size_t> order = bySupport(true);
+		if(attributes_ > COOC_LIMIT || order.empty())
+			return order;
+		auto cols = columns(order, COOC_SAMPLE);
+		vector<size_t> ones(cols.size());
+		for(size_t p=0; p<cols.size(); p++)
+			for(auto w : cols[p])
+				ones[p] += bitset<64>(w).count();
+		vector<size_t> chain{0}; // positions in ascending order, rarest first
+		vector<char> placed(cols.size());
+		placed[0] = 1;
+		for(size_t k=1; k<cols.size(); k++){
+			auto& last = cols[chain.back()];
+			size_t best = cols.size();
+			double best_sim = -1;
+			for(size_t p=0; p<cols.size(); p++){
+				if(placed[p])
+					continue;
+				size_t both = 0;
+				for(size_t w=0; w<last.size(); w++)
+					both += bitset<64>(last[w] & cols[p][w]).count();
+				size_t any = ones[chain.back()] + ones[p] - both;
+				double sim = any ? both / (double)any : 0;
+				if(sim > best_sim){ // ties go to the rarer one
+					best_sim = sim;
+					best = p;
+				}
+			}
+			placed[best] = 1;
+			chain.push_back(best);
+		}
+		for(auto& p : chain)
+			p = order[p];
+		return chain;
+	}
+
+	// ascending by closures needed to enumerate concepts of the sample having the attribute
+	vector<size_t> byCost()const{
+		vector<size_t> order = bySupport(true);
+		if(order.empty())
+			return order;
+		auto all = objects(PROBE_SAMPLE);
+		size_t m = order.size(), w = all.size();
+		size_t budget = max((size_t)8, (size_t)PROBE_WORK / (m * m * max((size_t)1, w)));
+		vector<size_t> cost(attributes_);
+		vector<size_t> probed(m);
+		for(size_t p=0; p<m; p++){
+			// the attribute goes first, the rest keep ascending order
+			copy(order.begin(), order.end(), probed.begin());
+			rotate(probed.begin(), probed.begin() + p, probed.begin() + p + 1);
+			Probe probe(columns(probed, PROBE_SAMPLE), all, minCount(PROBE_SAMPLE), budget);
+			probe.first();
+			cost[order[p]] = probe.closures;
+		}
+		stable_sort(order.begin(), order.end(), [&](size_t i, size_t j){
+			return cost[i] < cost[j];
+		});
+		return order;
+	}
+
+	// closures per concept on a probe run of the sample, lower is better
+	double score(const vector<size_t>& order)const{
+		auto all = objects(PROBE_SAMPLE);
+		size_t m = max((size_t)1, order.size()), w = max((size_t)1, all.size());
+		Probe probe(columns(order, PROBE_SAMPLE), all, minCount(PROBE_SAMPLE), max((size_t)64, (size_t)PROBE_WORK / (m * w)));
+		probe.all();
+		return probe.closures / (double)max((size_t)1, probe.concepts);
+	}
+public:
+	// supps - support of each attribute, probes scale min_support down to the sample
+	AttributeOrder(const vector<vector<int>>& values, size_t attributes, const vector<size_t>& supps, size_t min_support=0):
+		values_(values), attributes_(attributes), supps_(supps), min_support_(min_support), sample_(values.size()){
+		iota(sample_.begin(), sample_.end(), 0);
+		shuffle(sample_.begin(), sample_.end(), mt19937(1));
+	}
+
+	// order of given kind, AUTO reports scores of candidates to log if not null
+	vector<size_t> order(Kind kind, ostream* log=nullptr)const{
+		switch(kind){
+		case ASCENDING:
+			return bySupport(true);
+		case DESCENDING:
+			return bySupport(false);
+		case COOCCURRENCE:
+			return byCooccurrence();
+		case COST:
+			return byCost();
+		case AUTO:{
+			vector<size_t> best;
+			double best_score = 0;
+			for(auto k : {ASCENDING, DESCENDING, COOCCURRENCE, COST}){
+				auto candidate = order(k);
+				double s = score(candidate);
+				if(log)
+					*log << "Order " << name(k) << ": " << s << " closures per concept on probe" << endl;
+				if(best.empty() || s < best_score){
+					best_score = s;
+					best = move(candidate);
+				}
+			}
+			return best;
+		}
+		default:
+			vector<size_t> natural(attributes_);
+			iota(natural.begin(), natural.end(), 0);
+			return natural;
+		}
+	}
+
+	static const char* name(Kind kind){
+		static const char* names[] = { "natural", "asc", "desc", "cooc", "cost", "auto" };
+		return names[kind];
+	}
+
+	// kind by name, false if there is no such
+	static bool parse(const string& s, Kind& kind){
+		for(int k = NATURAL; k <= AUTO; k++)
+			if(s == name((Kind)k)){
+				kind = (Kind)k;
+				return true;
+			}
+		return false;
+	}
+};
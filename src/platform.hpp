@@ -1,34 +1,302 @@
 /**
-	Platform module - time measurement and IO infrastructure.
+	Platform module - time measurement, IO infrastructure and thread placement.
 */
 #pragma once
 
 
 #include <chrono>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <memory>
 #include <mutex>
 #include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <io.h>
+	#include <fcntl.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+#if defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+	#include <linux/perf_event.h>
+	#include <sys/syscall.h>
+#endif
+#if defined(__GLIBC__)
+	#include <malloc.h>
+#endif
 
 using namespace std;
 
-//
+// Hardware counters of the calling thread via perf_event_open, user space only.
+// With inherit threads started later are counted too, once they exit.
+// Counters that can't be opened (no PMU, perf_event_paranoid, not Linux) read as 0.
+class PerfCounters{
+public:
+	enum Event{ CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, EVENTS };
+	struct Values{
+		uint64_t v[EVENTS];
+		Values(){
+			for(auto& x : v)
+				x = 0;
+		}
+		Values& operator+=(const Values& o){
+			for(int e=0; e<EVENTS; e++)
+				v[e] += o.v[e];
+			return *this;
+		}
+		void print(ostream& os)const{
+			if(!v[CYCLES] && !v[INSTRUCTIONS]){
+				os << "unavailable";
+				return;
+			}
+			for(int e=0; e<EVENTS; e++)
+				os << (e ? ", " : "") << name((Event)e) << " " << v[e];
+			if(v[CYCLES])
+				os << ", ipc " << (double)v[INSTRUCTIONS] / v[CYCLES];
+		}
+		void printJSON(ostream& os)const{
+			for(int e=0; e<EVENTS; e++)
+				os << (e ? ", " : "") << "\"" << name((Event)e) << "\": " << v[e];
+		}
+	};
+private:
+	int fds_[EVENTS];
+public:
+	explicit PerfCounters(bool inherit){
+		for(auto& fd : fds_)
+			fd = -1;
+#if defined(__linux__)
+		static const uint32_t types[EVENTS] = {
+			PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+		};
+		static const uint64_t configs[EVENTS] = {
+			PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+			PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+		};
+		for(int e=0; e<EVENTS; e++){
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = types[e];
+			attr.config = configs[e];
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.inherit = inherit;
+			fds_[e] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+#endif
+	}
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters(){
+#if !defined(_WIN32)
+		for(auto fd : fds_)
+			if(fd >= 0)
+				close(fd);
+#endif
+	}
+
+	// counts since opening
+	Values read()const{
+		Values r;
+#if !defined(_WIN32)
+		for(int e=0; e<EVENTS; e++){
+			uint64_t v;
+			if(fds_[e] >= 0 && ::read(fds_[e], &v, sizeof(v)) == sizeof(v))
+				r.v[e] = v;
+		}
+#endif
+		return r;
+	}
+
+	static const char* name(Event e){
+		static const char* names[] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+		return names[e];
+	}
+
+	// global switch: measure() and algorithms count events
+	static bool& enabled(){
+		static bool on = false;
+		return on;
+	}
+};
+
+// run fn, print time it took (and hardware counters if enabled) if condition holds
 template<class Fn>
 void measure(Fn&& fn, const char* msg, bool condition=true){
 	using namespace std::chrono;
 	if(condition){
 		duration<double> elapsed;
+		unique_ptr<PerfCounters> perf;
+		if(PerfCounters::enabled())
+			perf.reset(new PerfCounters(true));
 		auto beg = high_resolution_clock::now();
 		fn();
 		auto end = high_resolution_clock::now();
 		elapsed = end - beg;
 		cerr << msg << ": " << elapsed.count() << endl;
+		if(perf){
+			cerr << msg << " counters: ";
+			perf->read().print(cerr);
+			cerr << endl;
+		}
 	}
 	else
 		fn();
 }
 
 
+// Make everything written to the file so far durable, via any descriptor of it
+inline bool syncFile(const string& path){
+#if defined(_WIN32)
+	int fd = _open(path.c_str(), _O_RDWR);
+	if(fd < 0)
+		return false;
+	bool ok = _commit(fd) == 0;
+	_close(fd);
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+	bool ok = fsync(fd) == 0;
+	close(fd);
+#endif
+	return ok;
+}
+
+// Cut the file down to size bytes
+inline bool truncateFile(const string& path, size_t size){
+#if defined(_WIN32)
+	int fd = _open(path.c_str(), _O_RDWR);
+	if(fd < 0)
+		return false;
+	bool ok = _chsize_s(fd, size) == 0;
+	_close(fd);
+	return ok;
+#else
+	return truncate(path.c_str(), size) == 0;
+#endif
+}
+
+// Replace contents of the file so that either old or new contents survive a crash
+inline bool replaceFile(const string& path, const vector<unsigned char>& data){
+	string tmp = path + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "wb");
+	if(!f)
+		return false;
+	bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+	ok = fclose(f) == 0 && ok;
+	ok = ok && syncFile(tmp);
+#if defined(_WIN32)
+	remove(path.c_str()); // rename doesn't replace on Windows
+#endif
+	return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// Read the whole file, false if it can't be opened
+inline bool readFile(const string& path, vector<unsigned char>& data){
+	FILE* f = fopen(path.c_str(), "rb");
+	if(!f)
+		return false;
+	data.clear();
+	unsigned char chunk[1<<16];
+	for(size_t n; (n = fread(chunk, 1, sizeof(chunk), f)) != 0; )
+		data.insert(data.end(), chunk, chunk + n);
+	fclose(f);
+	return true;
+}
+
+// CPUs of each NUMA node, a single node with all CPUs where topology is unknown
+inline vector<vector<unsigned>> numaNodes(){
+	vector<vector<unsigned>> nodes;
+#if defined(__linux__)
+	for(unsigned n = 0;; n++){
+		string path = "/sys/devices/system/node/node" + to_string(n) + "/cpulist";
+		FILE* f = fopen(path.c_str(), "r");
+		if(!f)
+			break;
+		vector<unsigned> cpus;
+		unsigned first, last;
+		while(fscanf(f, "%u", &first) == 1){ // list of ranges: 0-3,8-11
+			last = first;
+			int c = fgetc(f);
+			if(c == '-'){
+				if(fscanf(f, "%u", &last) != 1)
+					break;
+				c = fgetc(f);
+			}
+			for(unsigned cpu = first; cpu <= last; cpu++)
+				cpus.push_back(cpu);
+			if(c != ',')
+				break;
+		}
+		fclose(f);
+		if(!cpus.empty()) // memory-only nodes have no CPUs
+			nodes.push_back(move(cpus));
+	}
+#endif
+	if(nodes.empty()){
+		unsigned cpus = thread::hardware_concurrency();
+		nodes.emplace_back();
+		for(unsigned cpu = 0; cpu < (cpus ? cpus : 1); cpu++)
+			nodes.back().push_back(cpu);
+	}
+	return nodes;
+}
+
+// Bind calling thread to the CPU, false if not supported
+inline bool pinThread(unsigned cpu){
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+// Start tracking peak of resident memory anew, false if not supported
+inline bool resetPeakMemory(){
+#if defined(__GLIBC__)
+	malloc_trim(0); // give back what is freed, or it stays resident and counts
+#endif
+#if defined(__linux__)
+	FILE* f = fopen("/proc/self/clear_refs", "w");
+	if(!f)
+		return false;
+	bool ok = fputs("5", f) >= 0; // 5 - reset peak RSS
+	return fclose(f) == 0 && ok;
+#else
+	return false;
+#endif
+}
+
+// Peak resident memory in kilobytes since start or the last reset, 0 if unknown
+inline size_t peakMemoryKb(){
+	size_t kb = 0;
+#if defined(__linux__)
+	FILE* f = fopen("/proc/self/status", "r");
+	if(!f)
+		return 0;
+	char line[256];
+	while(fgets(line, sizeof(line), f))
+		if(sscanf(line, "VmHWM: %zu", &kb) == 1)
+			break;
+	fclose(f);
+#endif
+	return kb;
+}
+
 // Simple I/O buffer with support for atomic portions of data (records).
 // Only complete (committed) records would be ever written to the stream
 class Buffer {
@@ -38,6 +306,8 @@ class Buffer {
 	size_t committed; // last committed position
 	ostream* out_;
 	shared_ptr<mutex> mut_;
+	size_t written_; // bytes flushed to the stream
+	uint64_t flush_ns_; // time spent flushing, including waits for the stream
 	Buffer(const Buffer&)=delete;
 	
 	size_t waterMark()const{ // size to flush
@@ -55,7 +325,7 @@ class Buffer {
 public:
 	Buffer(ostream& out, size_t sz=32): 
 		 buf((char*)malloc(sz)), size_(sz), cur(0), committed(0), out_(&out), 
-		 mut_(make_shared<mutex>()){}
+		 mut_(make_shared<mutex>()), written_(0), flush_ns_(0){}
 	//
 	Buffer& sync(Buffer& b){
 		mut_ = b.mut_;
@@ -68,6 +338,8 @@ public:
 		cur = b.cur;
 		committed = b.committed;
 		out_ = b.out_;
+		written_ = b.written_;
+		flush_ns_ = b.flush_ns_;
 		b.buf = nullptr;
 	}
 	// place c into buffer
@@ -78,7 +350,7 @@ public:
 		buf[cur++] = c;
 	}
 	// place len bytes from data
-	void put(char* data, size_t len){
+	void put(const char* data, size_t len){
 		if(cur + len > size_){
 			accomodate(len);
 		}
@@ -121,13 +393,19 @@ public:
 		committed = cur;
 		return *this;
 	}
+	// bytes flushed so far and time it took, nanoseconds
+	size_t written()const{ return written_; }
+	uint64_t flushTime()const{ return flush_ns_; }
 	// flushes all commited data
 	Buffer& flush(){
 		if(committed){
+			auto beg = chrono::steady_clock::now();
 			{
 				lock_guard<mutex> lock(*mut_);
 				out_->write(buf, committed);
 			}
+			flush_ns_ += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - beg).count();
+			written_ += committed;
 			// memmove - may overlap
 			memmove(buf, buf+committed, size_ - committed);
 			cur -= committed;
@@ -0,0 +1,165 @@
+/**
+	Profile of the enumeration tree: concepts, closures and time spent
+	at each depth of recursion, split by top-level subtrees - the tasks
+	that parallel algorithms schedule at parLevel().
+
+	A frame is one call of the algorithm (one concept), time and closures
+	are charged to the innermost open frame, so each frame gets self time only.
+	Subtrees are keyed by the intent at their root, the part above them has empty key.
+
+	Output is either folded stacks, one line per subtree and depth:
+		depth 0;depth 1;subtree 3 7 12;depth 4 <self time in microseconds>
+	which flamegraph.pl and speedscope take as is, or histograms by depth and by subtree.
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Profile{
+public:
+	struct Counters{
+		uint64_t concepts;
+		uint64_t closures;
+		uint64_t self_ns;
+		Counters(): concepts(0), closures(0), self_ns(0){}
+		Counters& operator+=(const Counters& c){
+			concepts += c.concepts;
+			closures += c.closures;
+			self_ns += c.self_ns;
+			return *this;
+		}
+	};
+private:
+	using Layers = vector<Counters>; // by depth
+	map<string, Layers> subtrees_;
+	Layers* cur_;
+	size_t sub_depth_; // depth of subtree roots
+	size_t base_; // depth of the first frame
+	size_t open_; // frames open
+	uint64_t last_ns_, last_closures_;
+
+	static uint64_t now(){
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// charge time and closures since the last event to the innermost frame
+	void charge(uint64_t closures){
+		uint64_t t = now();
+		if(open_){
+			auto& c = at(base_ + open_ - 1);
+			c.self_ns += t - last_ns_;
+			c.closures += closures - last_closures_;
+		}
+		last_ns_ = t;
+		last_closures_ = closures;
+	}
+
+	Counters& at(size_t depth){
+		if(cur_->size() <= depth)
+			cur_->resize(depth + 1);
+		return (*cur_)[depth];
+	}
+
+	static Counters sum(const Layers& layers){
+		Counters s;
+		for(auto& c : layers)
+			s += c;
+		return s;
+	}
+public:
+	explicit Profile(size_t sub_depth):
+		cur_(&subtrees_[""]), sub_depth_(sub_depth), base_(0), open_(0), last_ns_(0), last_closures_(0){}
+
+	// first frame is at given depth, for algorithms that run tasks rather than the whole tree
+	void base(size_t depth){ base_ = depth; }
+
+	// frame of a concept opens, key gives the subtree name if it starts here;
+	// closures - running count of the algorithm
+	template<class Key>
+	void enter(uint64_t closures, Key&& key){
+		charge(closures);
+		size_t depth = base_ + open_++;
+		if(depth == sub_depth_)
+			cur_ = &subtrees_[key()];
+		at(depth).concepts++;
+	}
+
+	void leave(uint64_t closures){
+		charge(closures);
+		if(base_ + --open_ == sub_depth_)
+			cur_ = &subtrees_[""];
+	}
+
+	Profile& operator+=(const Profile& p){
+		for(auto& s : p.subtrees_){
+			auto& layers = subtrees_[s.first];
+			if(layers.size() < s.second.size())
+				layers.resize(s.second.size());
+			for(size_t d=0; d<s.second.size(); d++)
+				layers[d] += s.second[d];
+		}
+		return *this;
+	}
+
+	// folded stacks with self time in microseconds, frames of no time are skipped
+	void printFolded(ostream& os)const{
+		for(auto& s : subtrees_){
+			for(size_t d=0; d<s.second.size(); d++){
+				uint64_t us = s.second[d].self_ns / 1000;
+				if(!us)
+					continue;
+				for(size_t i=0; i<=d; i++){
+					if(i)
+						os << ';';
+					if(i == sub_depth_ && !s.first.empty())
+						os << "subtree " << s.first;
+					else
+						os << "depth " << i;
+				}
+				os << ' ' << us << '\n';
+			}
+		}
+	}
+
+	// tables by depth and by subtree, the latter heaviest first and at most top of them
+	void printHistograms(ostream& os, size_t top)const{
+		Layers depths;
+		vector<pair<Counters, const string*>> subtrees;
+		for(auto& s : subtrees_){
+			if(depths.size() < s.second.size())
+				depths.resize(s.second.size());
+			for(size_t d=0; d<s.second.size(); d++)
+				depths[d] += s.second[d];
+			if(!s.first.empty())
+				subtrees.emplace_back(sum(s.second), &s.first);
+		}
+		os << "Depth\tConcepts\tClosures\tTime(s)\n";
+		for(size_t d=0; d<depths.size(); d++)
+			os << d << '\t' << depths[d].concepts << '\t' << depths[d].closures
+				<< '\t' << depths[d].self_ns / 1e9 << '\n';
+		if(subtrees.empty())
+			return;
+		sort(subtrees.begin(), subtrees.end(), [](const pair<Counters, const string*>& a, const pair<Counters, const string*>& b){
+			return a.first.self_ns > b.first.self_ns;
+		});
+		Counters all = sum(depths);
+		os << "Subtrees at depth " << sub_depth_ << ": " << subtrees.size()
+			<< ", heaviest " << min(top, subtrees.size()) << ":\n"
+			<< "Share\tConcepts\tClosures\tTime(s)\tIntent\n";
+		for(size_t i=0; i<subtrees.size() && i<top; i++){
+			auto& c = subtrees[i].first;
+			os << fixed << setprecision(1) << (all.self_ns ? 100.0 * c.self_ns / all.self_ns : 0) << "%"
+				<< defaultfloat << setprecision(6) << '\t' << c.concepts << '\t' << c.closures
+				<< '\t' << c.self_ns / 1e9 << '\t' << *subtrees[i].second << '\n';
+		}
+	}
+};
@@ -0,0 +1,109 @@
+/**
+	Progress of long runs: a reporter thread samples counters of all workers
+	every period and prints concepts done, throughput and estimated time left.
+
+	Each algorithm (a worker thread for forked ones) gets a slot of counters
+	only it writes to, so counting is a plain relaxed store, no contention.
+	The estimate is by top-level tasks: elapsed time scaled by tasks left per task done.
+	Tasks keep being added while the serial step runs, so early estimates are low.
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+using namespace std;
+
+class Progress{
+public:
+	// counters of one writer
+	struct Slot{
+		atomic<uint64_t> concepts;
+		atomic<uint64_t> tasks; // top-level tasks done
+		char pad[64 - 2*sizeof(atomic<uint64_t>)]; // keep writers off each other's cache line
+		Slot(): concepts(0), tasks(0){}
+
+		static void bump(atomic<uint64_t>& c, uint64_t n=1){
+			c.store(c.load(memory_order_relaxed) + n, memory_order_relaxed);
+		}
+	};
+private:
+	double period_; // seconds between reports
+	ostream& os_;
+	mutex mtx_;
+	condition_variable cv_;
+	deque<Slot> slots_; // deque keeps them in place as new ones are added
+	atomic<uint64_t> total_tasks_;
+	bool done_;
+	thread reporter_;
+	chrono::steady_clock::time_point start_;
+
+	static void printDuration(ostream& os, double s){
+		uint64_t t = (uint64_t)s;
+		if(t >= 3600)
+			os << t / 3600 << "h";
+		if(t >= 60)
+			os << t / 60 % 60 << "m";
+		os << t % 60 << "s";
+	}
+
+	void report(){
+		uint64_t concepts = 0, tasks = 0;
+		for(auto& s : slots_){
+			concepts += s.concepts.load(memory_order_relaxed);
+			tasks += s.tasks.load(memory_order_relaxed);
+		}
+		uint64_t total = total_tasks_.load(memory_order_relaxed);
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start_).count();
+		os_ << "Progress: ";
+		printDuration(os_, elapsed);
+		os_ << ", " << concepts << " concepts, " << (uint64_t)(concepts / elapsed) << "/s";
+		if(total){
+			os_ << ", tasks " << tasks << "/" << total;
+			if(tasks){
+				os_ << ", ETA ";
+				printDuration(os_, elapsed * (total - min(tasks, total)) / tasks);
+			}
+		}
+		os_ << endl;
+	}
+public:
+	Progress(double period, ostream& os):
+		period_(period), os_(os), total_tasks_(0), done_(false), start_(chrono::steady_clock::now()){}
+
+	~Progress(){ stop(); }
+
+	// counters for one more writer, live as long as this object
+	Slot* slot(){
+		lock_guard<mutex> lock(mtx_);
+		slots_.emplace_back();
+		return &slots_.back();
+	}
+
+	void addTasks(uint64_t n){ total_tasks_ += n; }
+
+	void start(){
+		start_ = chrono::steady_clock::now();
+		reporter_ = thread([this]{
+			unique_lock<mutex> lock(mtx_);
+			while(!cv_.wait_for(lock, chrono::duration<double>(period_), [this]{ return done_; }))
+				report();
+		});
+	}
+
+	void stop(){
+		{
+			lock_guard<mutex> lock(mtx_);
+			done_ = true;
+		}
+		cv_.notify_all();
+		if(reporter_.joinable())
+			reporter_.join();
+	}
+};
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <assert.h>
 #include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <iostream>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 using namespace std;
 
@@ -29,28 +34,117 @@ public:
 
 // Shared  queue - supports simlutanious pushing and popping.
 // May be drained multiple times in the process,
-// closing the queue is thus a separate primitive
+// closing the queue is thus a separate primitive.
+// Optionally bounded by memory budget: once queued items take more than that
+// push either blocks until consumers catch up (backpressure) or, with spilling set up,
+// items go to a temporary file to be read back in order.
 template<class T>
 class SharedQueue{
 	queue<T> queue_;
 	mutex mtx_;
 	condition_variable cond_;
+	condition_variable space_; // producers waiting for the queue to shrink
 	bool done_;
+	size_t budget_; // bytes, 0 - unbounded
+	size_t used_; // bytes taken by items in memory
+	function<size_t(T&)> footprint_;
+	function<void(T&, vector<unsigned char>&)> save_;
+	function<void(const vector<unsigned char>&, T&)> load_;
+	FILE* spill_; // spilled items as [length] [bytes], newer than anything in memory
+	long read_pos_, write_pos_;
+	size_t spilled_; // items in the file
+	vector<unsigned char> buf_;
+
+	void spill(T& val){
+		if(!spill_)
+			spill_ = tmpfile();
+		buf_.clear();
+		save_(val, buf_);
+		size_t len = buf_.size();
+		fseek(spill_, write_pos_, SEEK_SET);
+		if(fwrite(&len, sizeof(len), 1, spill_) != 1 || fwrite(buf_.data(), 1, len, spill_) != len){
+			cerr << "Failed to spill queued task to disk" << endl;
+			abort();
+		}
+		write_pos_ = ftell(spill_);
+		spilled_++;
+	}
+
+	void unspill(vector<unsigned char>& bytes){
+		size_t len;
+		fseek(spill_, read_pos_, SEEK_SET);
+		if(fread(&len, sizeof(len), 1, spill_) != 1){
+			cerr << "Failed to read spilled task" << endl;
+			abort();
+		}
+		bytes.resize(len);
+		if(fread(bytes.data(), 1, len, spill_) != len){
+			cerr << "Failed to read spilled task" << endl;
+			abort();
+		}
+		read_pos_ = ftell(spill_);
+		if(--spilled_ == 0) // start over, reusing the file
+			read_pos_ = write_pos_ = 0;
+	}
 public:
-	SharedQueue():done_(false){}
+	SharedQueue():done_(false), budget_(0), used_(0), spill_(nullptr),
+		read_pos_(0), write_pos_(0), spilled_(0){}
+	~SharedQueue(){
+		if(spill_)
+			fclose(spill_);
+	}
+
+	// limit memory taken by queued items, footprint tells bytes of an item
+	void bound(size_t budget, function<size_t(T&)> footprint){
+		budget_ = budget;
+		footprint_ = footprint;
+	}
+
+	// spill items over the budget to disk instead of blocking producers
+	void spillWith(function<void(T&, vector<unsigned char>&)> save,
+		function<void(const vector<unsigned char>&, T&)> load){
+		save_ = save;
+		load_ = load;
+	}
+
 	bool pop(T& val){
 		unique_lock<mutex> lock(mtx_);
-		cond_.wait(lock, [&]{ return !queue_.empty() || done_; });
-		if(queue_.empty()) // done -> and queue is empty
+		cond_.wait(lock, [&]{ return !queue_.empty() || spilled_ || done_; });
+		if(!queue_.empty()){
+			if(budget_){
+				used_ -= footprint_(queue_.front());
+				space_.notify_one();
+			}
+			val = move(queue_.front());
+			queue_.pop();
+			return true;
+		}
+		if(!spilled_) // done -> and queue is empty
 			return false;
-		val = move(queue_.front());
-		queue_.pop();
+		vector<unsigned char> bytes;
+		unspill(bytes);
+		lock.unlock();
+		load_(bytes, val);
 		return true;
 	}
 
 	void push(T&& val){
 		unique_lock<mutex> lock(mtx_);
 		assert(!done_); // must not push after closing the queue
+		if(budget_){
+			size_t size = footprint_(val);
+			if(save_){
+				if(spilled_ || (used_ + size > budget_ && !queue_.empty())){
+					spill(val);
+					lock.unlock();
+					cond_.notify_one();
+					return;
+				}
+			}
+			else // an item bigger then budget still goes through an empty queue
+				space_.wait(lock, [&]{ return used_ + size <= budget_ || queue_.empty(); });
+			used_ += size;
+		}
 		queue_.push(move(val));
 		lock.unlock();
 		cond_.notify_one();
@@ -0,0 +1,148 @@
+/**
+	Context reduction - removes attributes that don't change the concept lattice:
+		- duplicates (attributes with the same column), one of each kind is kept;
+		- reducible ones, whose column is the intersection of larger columns,
+		this includes full columns and an empty column if no object has all attributes.
+	Identical objects may be merged into one, that keeps intents, and supports too
+	if each merged object is weighted by the number of originals.
+
+	An intent of the reduced context is put back into original attributes by adding
+	each removed attribute whose "up-set" is in the intent: the kept attributes
+	with column containing its column (empty up-set - the attribute is in every intent).
+
+	Columns and rows are sorted lists of numbers, so memory is linear in size of data.
+*/
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+using namespace std;
+
+class ContextReduction{
+public:
+	struct Removed{
+		size_t attr; // original number
+		vector<size_t> up; // kept attributes (new numbers) that imply it
+	};
+private:
+	vector<size_t> kept_; // new number -> original
+	vector<Removed> removed_;
+
+	using List = vector<size_t>;
+
+	static void intersect(List& a, const List& b){
+		a.erase(set_intersection(a.begin(), a.end(), b.begin(), b.end(), a.begin()), a.end());
+	}
+public:
+	// reduce objects given as lists of attributes < attributes, rewriting them in new numbers
+	ContextReduction(vector<vector<int>>& values, size_t attributes){
+		size_t objects = values.size();
+		vector<List> rows(objects), cols(attributes);
+		for(size_t o=0; o<objects; o++){
+			for(auto a : values[o])
+				rows[o].push_back(a);
+			sort(rows[o].begin(), rows[o].end());
+			rows[o].erase(unique(rows[o].begin(), rows[o].end()), rows[o].end());
+			for(auto a : rows[o])
+				cols[a].push_back(o);
+		}
+		// clarify: rep[a] - the first attribute with the same column
+		vector<size_t> order(attributes), rep(attributes);
+		iota(order.begin(), order.end(), 0);
+		stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return cols[a] < cols[b]; });
+		for(size_t i=0; i<attributes; i++)
+			rep[order[i]] = i && cols[order[i]] == cols[order[i-1]] ? rep[order[i-1]] : order[i];
+		// intent of each column: attributes common to all of its objects
+		vector<List> intent(attributes);
+		vector<char> keep(attributes);
+		List all(attributes), up;
+		iota(all.begin(), all.end(), 0);
+		for(size_t a=0; a<attributes; a++){
+			if(rep[a] != a)
+				continue;
+			auto& I = intent[a];
+			I = all;
+			for(auto o : cols[a]){
+				intersect(I, rows[o]);
+				if(I.size() == 1) // nothing but a itself, can't get any smaller
+					break;
+			}
+			// reducible if larger columns intersect to exactly this one (no larger columns - to all objects)
+			up.clear();
+			for(auto b : I)
+				if(rep[b] == b && b != a)
+					up.push_back(b);
+			sort(up.begin(), up.end(), [&](size_t x, size_t y){ return cols[x].size() < cols[y].size(); });
+			size_t meet = objects;
+			List ext;
+			for(size_t i=0; i<up.size() && meet > cols[a].size(); i++){
+				if(i == 0)
+					ext = cols[up[i]];
+				else
+					intersect(ext, cols[up[i]]);
+				meet = ext.size(); // always contains column of a, so equal once sizes are
+			}
+			keep[a] = meet != cols[a].size();
+		}
+		vector<size_t> renum(attributes, ~(size_t)0);
+		for(size_t a=0; a<attributes; a++)
+			if(keep[a]){
+				renum[a] = kept_.size();
+				kept_.push_back(a);
+			}
+		for(size_t a=0; a<attributes; a++){
+			if(keep[a])
+				continue;
+			Removed r{a, {}};
+			for(auto b : intent[rep[a]])
+				if(keep[b])
+					r.up.push_back(renum[b]);
+			removed_.push_back(move(r));
+		}
+		for(size_t o=0; o<objects; o++){
+			values[o].clear();
+			for(auto a : rows[o])
+				if(keep[a])
+					values[o].push_back((int)renum[a]);
+		}
+	}
+
+	// original numbers of kept attributes by new number
+	const vector<size_t>& kept()const{ return kept_; }
+	const vector<Removed>& removed()const{ return removed_; }
+
+	// identical objects become one, returns original objects of each new object
+	static vector<vector<size_t>> mergeObjects(vector<vector<int>>& values){
+		for(auto& v : values){
+			sort(v.begin(), v.end());
+			v.erase(unique(v.begin(), v.end()), v.end());
+		}
+		vector<vector<size_t>> found;
+		vector<size_t> order(values.size());
+		iota(order.begin(), order.end(), 0);
+		stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return values[a] < values[b]; });
+		vector<vector<int>> merged;
+		for(size_t i=0; i<order.size(); i++){
+			if(i && values[order[i]] == merged.back()){
+				found.back().push_back(order[i]);
+				continue;
+			}
+			merged.push_back(move(values[order[i]]));
+			found.push_back({order[i]});
+		}
+		// first appearance order, so that order of objects stays close to the input
+		vector<size_t> by_first(merged.size());
+		iota(by_first.begin(), by_first.end(), 0);
+		sort(by_first.begin(), by_first.end(), [&](size_t a, size_t b){ return found[a][0] < found[b][0]; });
+		vector<vector<size_t>> groups(merged.size());
+		values.resize(merged.size());
+		for(size_t i=0; i<by_first.size(); i++){
+			values[i] = move(merged[by_first[i]]);
+			groups[i] = move(found[by_first[i]]);
+			sort(groups[i].begin(), groups[i].end());
+		}
+		return groups;
+	}
+};
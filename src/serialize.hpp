@@ -0,0 +1,188 @@
+/**
+	Compact binary serialization of sets, the building block for moving
+	mining states between processes, spilling and checkpointing them, and of binary output.
+
+	Numbers are written as LEB128 varints. Every set is 1 byte of format
+	followed by its payload, the format with the shortest payload is picked per set:
+		NIL - null set
+		ALL - every item of the universe
+		LIST - number of items followed by deltas between consecutive items
+		RUNS - number of runs followed by lengths of alternating runs of absent/present items
+		RAW - bitmap of the universe, 8 items per byte
+*/
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "sets.hpp"
+
+using namespace std;
+
+class Encoder{
+	enum : unsigned char { NIL, ALL, LIST, RUNS, RAW };
+	vector<unsigned char> buf_;
+	vector<unsigned> items_; // scratch for the set being written
+	size_t objects_, attributes_;
+
+	static size_t varintSize(size_t v){
+		size_t n = 1;
+		for(; v >= 0x80; v >>= 7)
+			n++;
+		return n;
+	}
+
+	template<class Fn>
+	void eachRun(Fn&& fn){
+		size_t next = 0; // first item not yet covered by runs
+		for(size_t i=0; i<items_.size(); ){
+			size_t k = i + 1;
+			while(k < items_.size() && items_[k] == items_[k-1] + 1)
+				k++;
+			fn(items_[i] - next); // absent
+			fn(k - i); // present
+			next = items_[k-1] + 1;
+			i = k;
+		}
+	}
+public:
+	Encoder(size_t objects, size_t attributes):objects_(objects), attributes_(attributes){}
+
+	size_t objects()const{ return objects_; }
+	size_t attributes()const{ return attributes_; }
+
+	// bytes written so far
+	const vector<unsigned char>& bytes()const{ return buf_; }
+	void clear(){ buf_.clear(); }
+
+	void word(size_t v){
+		for(; v >= 0x80; v >>= 7)
+			buf_.push_back((unsigned char)(v | 0x80));
+		buf_.push_back((unsigned char)v);
+	}
+
+	// length-prefixed bytes
+	void block(const vector<unsigned char>& bytes){
+		word(bytes.size());
+		buf_.insert(buf_.end(), bytes.begin(), bytes.end());
+	}
+
+	// write set of items below universe
+	template<class Set>
+	void set(Set& set, size_t universe){
+		if(set.null()){
+			buf_.push_back(NIL);
+			return;
+		}
+		items_.clear();
+		set.each([&](size_t i){
+			items_.push_back((unsigned)i);
+		});
+		if(!is_sorted(items_.begin(), items_.end())) // hash sets go in no particular order
+			sort(items_.begin(), items_.end());
+		writeItems(universe);
+	}
+
+	// write sorted items below universe, in the same formats as a set
+	void items(const vector<size_t>& items, size_t universe){
+		items_.assign(items.begin(), items.end());
+		writeItems(universe);
+	}
+private:
+	// items_ must be ascending, deltas and runs rely on it
+	void writeItems(size_t universe){
+		size_t n = items_.size();
+		if(n == universe){
+			buf_.push_back(ALL);
+			return;
+		}
+		size_t list = varintSize(n), runs = 0, nruns = 0;
+		for(size_t i=0, prev=0; i<n; prev = items_[i]+1, i++)
+			list += varintSize(items_[i] - prev);
+		eachRun([&](size_t len){
+			runs += varintSize(len);
+			nruns++;
+		});
+		runs += varintSize(nruns);
+		size_t raw = (universe + 7) / 8;
+		if(list <= runs && list <= raw){
+			buf_.push_back(LIST);
+			word(n);
+			for(size_t i=0, prev=0; i<n; prev = items_[i]+1, i++)
+				word(items_[i] - prev);
+		}
+		else if(runs <= raw){
+			buf_.push_back(RUNS);
+			word(nruns);
+			eachRun([&](size_t len){ word(len); });
+		}
+		else{
+			buf_.push_back(RAW);
+			size_t at = buf_.size();
+			buf_.resize(at + raw);
+			for(auto i : items_)
+				buf_[at + i/8] |= 1<<(i%8);
+		}
+	}
+};
+
+class Decoder{
+	enum : unsigned char { NIL, ALL, LIST, RUNS, RAW };
+	const unsigned char* p_;
+public:
+	explicit Decoder(const unsigned char* p):p_(p){}
+
+	// position past what was read so far
+	const unsigned char* pos()const{ return p_; }
+
+	size_t word(){
+		size_t v = 0;
+		for(unsigned shift = 0;; shift += 7){
+			unsigned char b = *p_++;
+			v |= (size_t)(b & 0x7F) << shift;
+			if(!(b & 0x80))
+				return v;
+		}
+	}
+
+	vector<unsigned char> block(){
+		size_t len = word();
+		p_ += len;
+		return vector<unsigned char>(p_ - len, p_);
+	}
+
+	// read set of items below universe into set
+	template<class Set>
+	void set(Set& set, size_t universe){
+		unsigned char fmt = *p_++;
+		if(fmt == NIL){
+			set = Set();
+			return;
+		}
+		if(fmt == ALL){
+			toFull(set);
+			return;
+		}
+		toEmpty(set);
+		if(fmt == LIST){
+			for(size_t n = word(), next = 0; n; n--){
+				next += word();
+				set.add(next++);
+			}
+		}
+		else if(fmt == RUNS){
+			size_t next = 0;
+			for(size_t n = word(); n; n -= 2){
+				next += word();
+				for(size_t k = word(); k; k--)
+					set.add(next++);
+			}
+		}
+		else{
+			size_t bytes = (universe + 7) / 8;
+			for(size_t i=0; i<bytes; i++)
+				for(unsigned b = p_[i]; b; b &= b-1) // skip zero bytes, visit only set bits
+					set.add(i*8 + ctz(b));
+			p_ += bytes;
+		}
+	}
+};
@@ -0,0 +1,219 @@
+/*
+setbench - microbenchmarks of set implementations,
+a part of JSM toolset.
+
+Measures kernels that concept generation is made of on random sets
+of several sizes and densities, for every set implementation.
+Sets are built with a fixed seed, so runs are comparable.
+Ops that modify their input (intersections) or depend on a fresh one (count
+after an intersection) run after restoring that input each time; their records
+give the time of both together and, next to it, the time of restoring alone.
+
+Output:
+JSON array, one record per set, operation, size and density:
+	{"set": "bitvec", "op": "copy", "size": 4096, "density": 0.1, "iterations": N, "ns_per_op": T}
+	{"set": "bitvec", "op": "intersect", "size": 4096, "density": 0.1, "iterations": N, "ns_per_op": T, "setup_ns_per_op": S}
+
+Authors: Dmitry Olshansky (c) 2015-
+*/
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sets.hpp"
+
+using namespace std;
+
+namespace {
+
+volatile size_t sink; // results go here so that the work isn't optimized away
+
+struct Options{
+	double min_time = 0.05; // seconds per measurement
+	string filter; // only cases with set or op name containing this
+	vector<size_t> sizes = {256, 4096, 65536};
+	vector<double> densities = {0.01, 0.1, 0.5};
+};
+
+struct Record{
+	const char* set;
+	const char* op;
+	size_t size;
+	double density;
+	size_t iterations;
+	double ns_per_op;
+	double setup_ns_per_op; // part of ns_per_op spent restoring input, < 0 if op needs none
+};
+
+// run fn in batches growing until one takes at least min_time, report time per call
+template<class Fn>
+Record timeOp(const Options& opts, const char* set, const char* op, size_t size, double density, Fn&& fn){
+	using namespace std::chrono;
+	fn(); // warm up caches and allocator
+	size_t n = 1;
+	for(;;){
+		auto beg = high_resolution_clock::now();
+		for(size_t i=0; i<n; i++)
+			fn();
+		duration<double> elapsed = high_resolution_clock::now() - beg;
+		if(elapsed.count() >= opts.min_time || n >= ((size_t)1<<30))
+			return Record{set, op, size, density, n, elapsed.count() * 1e9 / n, -1};
+		n = elapsed.count() > opts.min_time / 100 ? (size_t)(n * opts.min_time * 1.2 / elapsed.count()) + 1 : n * 10;
+	}
+}
+
+// ops that need a fresh input each call: setup then fn are timed together
+// and setup on its own, both are reported as the difference may be within noise
+template<class Setup, class Fn>
+Record timeAfter(const Options& opts, const char* set, const char* op, size_t size, double density, Setup&& setup, Fn&& fn){
+	Record r = timeOp(opts, set, op, size, density, [&]{
+		setup();
+		fn();
+	});
+	r.setup_ns_per_op = timeOp(opts, set, op, size, density, setup).ns_per_op;
+	return r;
+}
+
+// sorted random values < size, each taken with given probability
+vector<size_t> randomValues(mt19937& rng, size_t size, double density){
+	bernoulli_distribution pick(density);
+	vector<size_t> values;
+	for(size_t i=0; i<size; i++)
+		if(pick(rng))
+			values.push_back(i);
+	return values;
+}
+
+template<class Set>
+Set makeSet(const vector<size_t>& values){
+	Set s = Set::newEmpty();
+	for(auto v : values)
+		s.add(v);
+	return s;
+}
+
+template<class Set>
+void benchSet(const Options& opts, const char* name, vector<Record>& out){
+	auto wanted = [&](const char* op){
+		return opts.filter.empty() || strstr(name, opts.filter.c_str()) || strstr(op, opts.filter.c_str());
+	};
+	for(auto size : opts.sizes){
+		Set::setSize(size);
+		for(auto density : opts.densities){
+			mt19937 rng(1);
+			auto va = randomValues(rng, size, density);
+			auto vb = randomValues(rng, size, density);
+			Set a = makeSet<Set>(va), b = makeSet<Set>(vb), c = Set::newEmpty();
+			Set same = makeSet<Set>(va); // equal to a, so that comparisons go all the way
+			Set sub = makeSet<Set>(va);
+			sub.intersect(b); // subset of a
+			size_t half = size / 2;
+			auto run = [&](const char* op, function<void()> fn){
+				if(wanted(op))
+					out.push_back(timeOp(opts, name, op, size, density, fn));
+			};
+			auto runAfter = [&](const char* op, function<void()> setup, function<void()> fn){
+				if(wanted(op))
+					out.push_back(timeAfter(opts, name, op, size, density, setup, fn));
+			};
+			auto restore = [&]{ c.copy(a); };
+			run("copy", restore);
+			runAfter("intersect", restore, [&]{ c.intersect(b); });
+			runAfter("intersect_up_to", restore, [&]{ c.intersect(b, half); });
+			run("equal_up_to", [&]{ sink = a.equal(same, half); });
+			run("subset_of", [&]{ sink = sub.subsetOf(a, size); });
+			run("each", [&]{
+				size_t sum = 0;
+				a.each([&](size_t v){ sum += v; });
+				sink = sum;
+			});
+			// right after an intersection, when bitvec has to recount
+			runAfter("count", [&]{
+				c.copy(a);
+				c.intersect(b);
+			}, [&]{ sink = c.count(); });
+			run("add", [&]{
+				toEmpty(c);
+				for(auto v : va)
+					c.add(v);
+			});
+			run("alloc_free", [&]{
+				Set s = Set::newEmpty();
+				sink = s.null();
+			});
+		}
+	}
+}
+
+void printJSON(ostream& os, const vector<Record>& records){
+	os << "[\n";
+	for(size_t i=0; i<records.size(); i++){
+		auto& r = records[i];
+		os << "\t{\"set\": \"" << r.set << "\", \"op\": \"" << r.op << "\", \"size\": " << r.size
+			<< ", \"density\": " << r.density << ", \"iterations\": " << r.iterations
+			<< ", \"ns_per_op\": " << r.ns_per_op;
+		if(r.setup_ns_per_op >= 0)
+			os << ", \"setup_ns_per_op\": " << r.setup_ns_per_op;
+		os << "}" << (i+1 < records.size() ? "," : "") << "\n";
+	}
+	os << "]\n";
+}
+
+// comma separated list of numbers
+template<class T>
+vector<T> parseList(const char* s){
+	vector<T> list;
+	char* end;
+	for(;;){
+		list.push_back((T)strtod(s, &end));
+		if(*end != ',')
+			return list;
+		s = end + 1;
+	}
+}
+
+}
+
+int main(int argc, char* argv[]){
+	Options opts;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; i++){
+		switch (argv[i][1]){
+		case 't':
+			// minimal time per measurement, milliseconds
+			opts.min_time = atof(argv[i] + 2) / 1000;
+			break;
+		case 'f':
+			opts.filter = argv[i] + 2;
+			break;
+		case 's':
+			opts.sizes = parseList<size_t>(argv[i] + 2);
+			break;
+		case 'd':
+			opts.densities = parseList<double>(argv[i] + 2);
+			break;
+		default:
+			cerr << "Unrecognized option: " << argv[i] << endl;
+			cerr << "Usage ./setbench [-t<ms-per-case>] [-f<set-or-op-filter>] [-s<size>,...] [-d<density>,...] [<output-json>]" << endl;
+			return 1;
+		}
+	}
+	vector<Record> records;
+	benchSet<BitVec<0>>(opts, "bitvec", records);
+	benchSet<LinearSet<0>>(opts, "linear", records);
+	benchSet<TreeSet<0>>(opts, "tree", records);
+	benchSet<HashSet<0>>(opts, "hash", records);
+	if (i < argc){
+		ofstream out(argv[i]);
+		printJSON(out, records);
+	}
+	else
+		printJSON(cout, records);
+	return 0;
+}
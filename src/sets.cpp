@@ -16,6 +16,11 @@ template<> size_t BitVec<1>::length = 0;
 	template<> __thread Pool* BitVec<1>::pool = nullptr;
 #endif
 
-size_t LinearSet::total;
+template<> size_t LinearSet<0>::total = 0;
+template<> size_t LinearSet<1>::total = 0;
 
-size_t TreeSet::total;
+template<> size_t TreeSet<0>::total = 0;
+template<> size_t TreeSet<1>::total = 0;
+
+template<> size_t HashSet<0>::total = 0;
+template<> size_t HashSet<1>::total = 0;
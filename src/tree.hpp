@@ -1,22 +1,137 @@
-#pragma once
-
-#include <iterator> 
-#include <set>
+/**
+	Sorted-block tree implementation of integer set concept.
+	A shallow B+-tree: integers live in fixed-capacity sorted leaves that are
+	stored contiguously, the inner level is a flat array of fence keys
+	(maximal key of each leaf) that lets searches and bulk operations
+	skip over whole leaves without touching them.
 
-#include "misc.hpp" // myEqual
+	Appending past the maximum (the dominant pattern for extents) never splits,
+	intersections are computed in place and produce densely packed leaves.
+*/
+#pragma once
 
+template<int tag>
 class TreeSet{
-	set<unsigned> tree;
+	enum { BLOCK = 64 }; // keys per leaf, 4 cache lines of payload
+	struct Leaf{
+		unsigned size;
+		unsigned keys[BLOCK];
+		Leaf():size(0){} // don't zero keys
+	};
+	// position in the set - leaf number and offset inside of the leaf
+	struct Cursor{
+		const TreeSet* set;
+		size_t leaf, pos;
+		explicit Cursor(const TreeSet* s):set(s), leaf(0), pos(0){}
+		bool done()const{ return leaf == set->leaves.size(); }
+		unsigned value()const{ return set->leaves[leaf].keys[pos]; }
+		// at the end or past the up_to limit
+		bool done(size_t up_to)const{ return done() || value() >= up_to; }
+		void next(){
+			if(++pos == set->leaves[leaf].size){
+				leaf++;
+				pos = 0;
+			}
+		}
+		// move to the first key >= v, skipping leaves by their fence keys
+		void seek(unsigned v){
+			auto& fence = set->fence;
+			if(fence[leaf] < v){
+				leaf = lower_bound(fence.begin() + leaf + 1, fence.end(), v) - fence.begin();
+				pos = 0;
+				if(done())
+					return;
+			}
+			auto& l = set->leaves[leaf];
+			pos = lower_bound(l.keys + pos, l.keys + l.size, v) - l.keys;
+		}
+	};
+	vector<Leaf> leaves;
+	vector<unsigned> fence; // fence[i] == max key of leaves[i]
+	size_t count_; // number of keys
 	bool full;
 	static size_t total;
 	//
-	bool hasAllUpTo(size_t up_to){
-		auto tend = lower_bound(tree.begin(), tree.end(), up_to);
+	Cursor begin()const{ return Cursor(this); }
+
+	// number of keys < up_to
+	size_t countUpTo(size_t up_to)const{
+		size_t leaf = lower_bound(fence.begin(), fence.end(), up_to) - fence.begin();
 		size_t cnt = 0;
-		for(auto it = tree.begin(); it != tend; it++)
-			if(*it != cnt++)
-				return false;
-		return cnt == up_to; // must visit each integer in the range
+		for(size_t i=0; i<leaf; i++)
+			cnt += leaves[i].size;
+		if(leaf != leaves.size()){
+			auto& l = leaves[leaf];
+			cnt += lower_bound(l.keys, l.keys + l.size, up_to) - l.keys;
+		}
+		return cnt;
+	}
+
+	bool hasAllUpTo(size_t up_to)const{
+		return countUpTo(up_to) == up_to; // keys are distinct - must be each integer in the range
+	}
+
+	// append key greater then any present
+	void append(unsigned v){
+		if(leaves.empty() || leaves.back().size == BLOCK){
+			leaves.emplace_back();
+			fence.push_back(v);
+		}
+		auto& l = leaves.back();
+		l.keys[l.size++] = v;
+		fence.back() = v;
+		count_++;
+	}
+
+	// drop all keys >= up_to
+	void cut(size_t up_to){
+		count_ = countUpTo(up_to);
+		size_t leaf = lower_bound(fence.begin(), fence.end(), up_to) - fence.begin();
+		if(leaf == leaves.size())
+			return;
+		auto& l = leaves[leaf];
+		size_t sz = lower_bound(l.keys, l.keys + l.size, up_to) - l.keys;
+		if(sz){
+			l.size = sz;
+			fence[leaf] = l.keys[sz-1];
+			leaf++;
+		}
+		leaves.resize(leaf);
+		fence.resize(leaf);
+	}
+
+	// turn "full" flag into explicit keys
+	void materialize(){
+		clearAll();
+		for(size_t i=0; i<total; i++)
+			append(i);
+	}
+
+	// in-place intersection, keys are written densely packed at or behind the read position
+	void intersectImpl(const TreeSet& set, size_t up_to){
+		Cursor a = begin(), b = set.begin();
+		size_t out = 0; // number of keys written so far
+		while(!a.done(up_to) && !b.done(up_to)){
+			unsigned x = a.value(), y = b.value();
+			if(x == y){
+				leaves[out / BLOCK].keys[out % BLOCK] = x;
+				out++;
+				a.next();
+				b.next();
+			}
+			else if(x < y)
+				a.seek(y);
+			else
+				b.seek(x);
+		}
+		size_t n = (out + BLOCK - 1) / BLOCK;
+		count_ = out;
+		leaves.resize(n);
+		fence.resize(n);
+		for(size_t i=0; i<n; i++){
+			leaves[i].size = (unsigned)(i+1 == n ? out - i*BLOCK : (size_t)BLOCK);
+			fence[i] = leaves[i].keys[leaves[i].size-1];
+		}
 	}
 	//
 public:
@@ -32,22 +147,38 @@ public:
 		return TreeSet();
 	}
 	static TreeSet newFull(){
-		return TreeSet(true);	
+		return TreeSet(true);
 	}
-	explicit TreeSet(bool is_full=false) : full(is_full){}
+	explicit TreeSet(bool is_full=false) : count_(0), full(is_full){}
 
 	bool null() const {
-		return !full && tree.empty();
+		return !full && leaves.empty();
+	}
+
+	// bytes of memory held
+	size_t footprint() const {
+		return leaves.capacity()*sizeof(Leaf) + fence.capacity()*sizeof(unsigned);
 	}
 
 	void clearAll(){
 		full = false;
-		tree.clear();
+		leaves.clear();
+		fence.clear();
+		count_ = 0;
 	}
 
 	void setAll(){
+		clearAll();
 		full = true;
-		tree.clear();
+	}
+
+	// number of items, O(1)
+	size_t count(){
+		return full ? total : count_;
+	}
+
+	bool hasMoreThen(size_t items){
+		return count() > items;
 	}
 
 	// apply to each item, calls functor with integers
@@ -58,16 +189,35 @@ public:
 				functor(i);
 		}
 		else
-			for_each(tree.begin(), tree.end(), functor);
+			for(auto& l : leaves)
+				for_each(l.keys, l.keys + l.size, functor);
+	}
+
+	// apply to each item while functor returns true, false if stopped early
+	template<class Fn>
+	bool eachWhile(Fn&& functor){
+		if(full){
+			for(size_t i=0; i<total; i++)
+				if(!functor(i))
+					return false;
+			return true;
+		}
+		for(auto& l : leaves)
+			for(size_t i=0; i<l.size; i++)
+				if(!functor(l.keys[i]))
+					return false;
+		return true;
 	}
 
 	// copy other set over this one
 	void copy(TreeSet& set){
 		full = set.full;
-		tree = set.tree;
+		leaves = set.leaves;
+		fence = set.fence;
+		count_ = set.count_;
 	}
 
-	// 
+	//
 	bool equal(TreeSet& set, size_t up_to){
 		if(full && set.full){
 			return true;
@@ -76,9 +226,16 @@ public:
 			return hasAllUpTo(up_to);
 		if(full)
 			return set.hasAllUpTo(up_to);
-		auto tend = lower_bound(tree.begin(), tree.end(), up_to);
-		auto set_end = lower_bound(set.tree.begin(), set.tree.end(), up_to);
-		return myEqual(tree.begin(), tend, set.tree.begin(), set_end);
+		Cursor a = begin(), b = set.begin();
+		for(;;){
+			bool a_end = a.done(up_to), b_end = b.done(up_to);
+			if(a_end || b_end)
+				return a_end && b_end;
+			if(a.value() != b.value())
+				return false;
+			a.next();
+			b.next();
+		}
 	}
 
 	//
@@ -86,27 +243,74 @@ public:
 		if(full ^ set.full)
 			return false;
 		// here we got both full or both not full
-		return full || tree == set.tree;
+		return full || equal(set, ~(size_t)0);
 	}
 
 	// set number j
 	TreeSet& add(size_t j){
-		if(!full){
-			tree.insert(j);
+		if(full)
+			return *this;
+		if(leaves.empty() || fence.back() < j){ // 100% of uses for extents in *CbO and *InClose2/3
+			append(j);
+			return *this;
 		}
+		size_t leaf = lower_bound(fence.begin(), fence.end(), j) - fence.begin();
+		auto* l = &leaves[leaf];
+		auto it = lower_bound(l->keys, l->keys + l->size, j);
+		if(*it == j)
+			return *this;
+		if(l->size == BLOCK){ // split in halves
+			size_t pos = it - l->keys;
+			leaves.emplace(leaves.begin() + leaf + 1);
+			fence.insert(fence.begin() + leaf + 1, fence[leaf]);
+			l = &leaves[leaf];
+			auto& r = leaves[leaf+1];
+			copy_n(l->keys + BLOCK/2, BLOCK/2, r.keys);
+			l->size = r.size = BLOCK/2;
+			fence[leaf] = l->keys[BLOCK/2 - 1];
+			if(pos >= BLOCK/2){
+				l = &r;
+				pos -= BLOCK/2;
+			}
+			it = l->keys + pos;
+		}
+		copy_backward(it, l->keys + l->size, l->keys + l->size + 1);
+		*it = j;
+		l->size++;
+		count_++;
 		return *this;
 	}
 
 	TreeSet& remove(size_t j){
-		//FIXME: implement remove for full set
-		assert(!full);
-		tree.erase(j);
+		if(full)
+			materialize();
+		if(leaves.empty() || fence.back() < j)
+			return *this;
+		size_t leaf = lower_bound(fence.begin(), fence.end(), j) - fence.begin();
+		auto& l = leaves[leaf];
+		auto it = lower_bound(l.keys, l.keys + l.size, j);
+		if(*it != j)
+			return *this;
+		std::copy(it + 1, l.keys + l.size, it);
+		count_--;
+		if(--l.size == 0){
+			leaves.erase(leaves.begin() + leaf);
+			fence.erase(fence.begin() + leaf);
+		}
+		else
+			fence[leaf] = l.keys[l.size-1];
 		return *this;
 	}
 
 	// contains number j
 	bool has(size_t j) {
-		return full || tree.find(j) != tree.end();
+		if(full)
+			return true;
+		size_t leaf = lower_bound(fence.begin(), fence.end(), j) - fence.begin();
+		if(leaf == leaves.size())
+			return false;
+		auto& l = leaves[leaf];
+		return binary_search(l.keys, l.keys + l.size, (unsigned)j);
 	}
 
 	TreeSet& intersect(TreeSet& set){
@@ -114,16 +318,11 @@ public:
 			return *this;
 		}
 		if(full){ // full but the other one isn't
-			tree = set.tree;
-			full = false;
+			copy(set);
 			return *this;
 		}
 		// both are not full - need to compute intersection
-		std::set<unsigned> inter;
-		set_intersection(tree.begin(), tree.end(),
-			set.tree.begin(), set.tree.end(), 
-			std::inserter(inter, inter.end()));
-		tree = inter;
+		intersectImpl(set, ~(size_t)0);
 		return *this;
 	}
 
@@ -133,33 +332,27 @@ public:
 			return *this;
 		}
 		if(full){ // full but the other one isn't
-			tree = set.tree;
-			full = false;
+			copy(set);
+			cut(up_to);
 			return *this;
 		}
-		// both are not full - need to compute intersection 
-		std::set<unsigned> inter;
-		// minding the up_to
-		auto tset = lower_bound(set.tree.begin(), set.tree.end(), up_to);
-		set_intersection(tree.begin(), tree.end(),
-			set.tree.begin(), tset, 
-			std::inserter(inter, inter.end()));
-		tree = inter;
+		// both are not full - need to compute intersection minding the up_to
+		intersectImpl(set, up_to);
 		return *this;
 	}
 
 	bool subsetOf(TreeSet& set, size_t up_to){
-		if(full){
-			if(set.full)
-				return true;
+		if(set.full)
+			return true;
+		if(full)
 			return set.hasAllUpTo(up_to);
+		Cursor a = begin(), b = set.begin();
+		for(; !a.done(up_to); a.next()){
+			if(!b.done())
+				b.seek(a.value());
+			if(b.done() || b.value() != a.value())
+				return false;
 		}
-		if(set.full){ // same but reverse - now our set must have all of elements
-			return hasAllUpTo(up_to);
-		}
-		auto tend = lower_bound(tree.begin(), tree.end(), up_to);
-		auto set_end = lower_bound(set.tree.begin(), set.tree.end(), up_to);
-		// got to compare
-		return myEqual(tree.begin(), tend, set.tree.begin(), set_end);
+		return true;
 	}
 };